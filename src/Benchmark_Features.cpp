@@ -0,0 +1,308 @@
+
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "dataStructures.h"
+#include "ringBuffer.hpp"
+#include "framePrefetcher.hpp"
+#include "matching2D.hpp"
+#include "objectDetection2D.hpp"
+#include "lidarData.hpp"
+#include "camFusion.hpp"
+
+using namespace std;
+
+// results of one detector / descriptor / matcher / selector combination on a single frame
+struct BenchmarkFrame
+{
+    size_t imgIndex;
+    size_t nKeypoints, nMatches;
+    double detMs, descMs, matchMs;
+    double ttcCamera, ttcLidar; // TTC of the vehicle in the ego lane (NAN if not available)
+};
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// the vehicle in the ego lane is the bounding box which has been assigned the most Lidar points
+static BoundingBox *egoLaneObject(DataFrame &frame)
+{
+    BoundingBox *best = nullptr;
+    for (auto it = frame.boundingBoxes.begin(); it != frame.boundingBoxes.end(); ++it)
+    {
+        if (!it->lidarPoints.empty() && (best == nullptr || it->lidarPoints.size() > best->lidarPoints.size()))
+        {
+            best = &(*it);
+        }
+    }
+    return best;
+}
+
+// AKAZE descriptors only work on AKAZE keypoints, ORB descriptors cannot be computed on SIFT keypoints
+static bool isValidCombination(const string &detectorType, const string &descriptorType)
+{
+    if (descriptorType == "AKAZE" && detectorType != "AKAZE")
+    {
+        return false;
+    }
+    if (descriptorType == "ORB" && detectorType == "SIFT")
+    {
+        return false;
+    }
+    return true;
+}
+
+/* BENCHMARK OF ALL KEYPOINT DETECTOR, DESCRIPTOR AND MATCHER COMBINATIONS */
+int main(int argc, const char *argv[])
+{
+    /* INIT VARIABLES AND DATA STRUCTURES */
+
+    // data location
+    string dataPath = "../";
+
+    // camera
+    string imgBasePath = dataPath + "images/";
+    string imgPrefix = "KITTI/2011_09_26/image_02/data/000000"; // left camera, color
+    string imgFileType = ".png";
+    int imgStartIndex = 0; // first file index to load (assumes Lidar and camera names have identical naming convention)
+    int imgEndIndex = 18;   // last file index to load
+    int imgStepWidth = 1; 
+    int imgFillWidth = 4;  // no. of digits which make up the file index (e.g. img-0001.png)
+
+    // object detection
+    string yoloBasePath = dataPath + "dat/yolo/";
+    string yoloClassesFile = yoloBasePath + "coco.names";
+    string yoloModelConfiguration = yoloBasePath + "yolov3.cfg";
+    string yoloModelWeights = yoloBasePath + "yolov3.weights";
+
+    // Lidar
+    string lidarPrefix = "KITTI/2011_09_26/velodyne_points/data/000000";
+    string lidarFileType = ".bin";
+
+    // calibration data for camera and lidar
+    cv::Mat P_rect_00(3,4,cv::DataType<double>::type); // 3x4 projection matrix after rectification
+    cv::Mat R_rect_00(4,4,cv::DataType<double>::type); // 3x3 rectifying rotation to make image planes co-planar
+    cv::Mat RT(4,4,cv::DataType<double>::type); // rotation matrix and translation vector
+    
+    RT.at<double>(0,0) = 7.533745e-03; RT.at<double>(0,1) = -9.999714e-01; RT.at<double>(0,2) = -6.166020e-04; RT.at<double>(0,3) = -4.069766e-03;
+    RT.at<double>(1,0) = 1.480249e-02; RT.at<double>(1,1) = 7.280733e-04; RT.at<double>(1,2) = -9.998902e-01; RT.at<double>(1,3) = -7.631618e-02;
+    RT.at<double>(2,0) = 9.998621e-01; RT.at<double>(2,1) = 7.523790e-03; RT.at<double>(2,2) = 1.480755e-02; RT.at<double>(2,3) = -2.717806e-01;
+    RT.at<double>(3,0) = 0.0; RT.at<double>(3,1) = 0.0; RT.at<double>(3,2) = 0.0; RT.at<double>(3,3) = 1.0;
+    
+    R_rect_00.at<double>(0,0) = 9.999239e-01; R_rect_00.at<double>(0,1) = 9.837760e-03; R_rect_00.at<double>(0,2) = -7.445048e-03; R_rect_00.at<double>(0,3) = 0.0;
+    R_rect_00.at<double>(1,0) = -9.869795e-03; R_rect_00.at<double>(1,1) = 9.999421e-01; R_rect_00.at<double>(1,2) = -4.278459e-03; R_rect_00.at<double>(1,3) = 0.0;
+    R_rect_00.at<double>(2,0) = 7.402527e-03; R_rect_00.at<double>(2,1) = 4.351614e-03; R_rect_00.at<double>(2,2) = 9.999631e-01; R_rect_00.at<double>(2,3) = 0.0;
+    R_rect_00.at<double>(3,0) = 0; R_rect_00.at<double>(3,1) = 0; R_rect_00.at<double>(3,2) = 0; R_rect_00.at<double>(3,3) = 1;
+    
+    P_rect_00.at<double>(0,0) = 7.215377e+02; P_rect_00.at<double>(0,1) = 0.000000e+00; P_rect_00.at<double>(0,2) = 6.095593e+02; P_rect_00.at<double>(0,3) = 0.000000e+00;
+    P_rect_00.at<double>(1,0) = 0.000000e+00; P_rect_00.at<double>(1,1) = 7.215377e+02; P_rect_00.at<double>(1,2) = 1.728540e+02; P_rect_00.at<double>(1,3) = 0.000000e+00;
+    P_rect_00.at<double>(2,0) = 0.000000e+00; P_rect_00.at<double>(2,1) = 0.000000e+00; P_rect_00.at<double>(2,2) = 1.000000e+00; P_rect_00.at<double>(2,3) = 0.000000e+00;    
+
+    // combined projection from Lidar into camera image coordinates
+    LidarProjector lidarProjector(P_rect_00, R_rect_00, RT);
+
+    // misc
+    double sensorFrameRate = 10.0 / imgStepWidth; // frames per second for Lidar and camera
+    float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1; // focus on ego lane
+    float shrinkFactor = 0.10;
+
+    // combinations under test
+    vector<string> detectorTypes = {"SHITOMASI", "HARRIS", "FAST", "BRISK", "ORB", "AKAZE", "SIFT"};
+    vector<string> descriptorTypes = {"BRISK", "BRIEF", "ORB", "FREAK", "AKAZE", "SIFT"};
+    vector<string> matcherTypes = {"MAT_BF", "MAT_FLANN"};
+    vector<string> selectorTypes = {"SEL_NN", "SEL_KNN"};
+
+    // command line : "--output <prefix>" selects the result files <prefix>_summary.csv and <prefix>_frames.csv
+    string outputPrefix = "benchmark";
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            outputPrefix = argv[++i];
+        }
+        else
+        {
+            cerr << "usage: " << argv[0] << " [--output <prefix>]" << endl;
+            return 1;
+        }
+    }
+
+    /* PREPARE SEQUENCE */
+
+    // object detection and Lidar clustering do not depend on the keypoint configuration, hence they are done once
+    // and all combinations work on the same bounding boxes and Lidar clusters
+    ObjectDetector objectDetector(yoloClassesFile, yoloModelConfiguration, yoloModelWeights);
+    FramePrefetcher prefetcher(imgBasePath, imgPrefix, imgFileType, lidarPrefix, lidarFileType,
+                               imgStartIndex, imgEndIndex, imgStepWidth, imgFillWidth, 2);
+
+    vector<FrameJob> sequence;
+    FrameJob job;
+    while (prefetcher.next(job))
+    {
+        objectDetector.detect(job.frame.cameraImg, job.frame.boundingBoxes);
+        loadLidarFromScan(job.frame.lidarPoints, job.frame.lidarScan, minX, maxX, maxY, minZ, maxZ, minR);
+        clusterLidarWithROI(job.frame.boundingBoxes, job.frame.lidarPoints, shrinkFactor, lidarProjector);
+        job.frame.lidarPoints.clear(); // only the clusters are needed from here on
+        job.frame.lidarScan.close();
+        sequence.push_back(std::move(job));
+        job = FrameJob();
+    }
+    cout << "Prepared " << sequence.size() << " frames" << endl;
+
+    ofstream summary((outputPrefix + "_summary.csv").c_str());
+    ofstream frames((outputPrefix + "_frames.csv").c_str());
+    if (!summary || !frames)
+    {
+        cerr << "cannot open result files " << outputPrefix << "_*.csv" << endl;
+        return 1;
+    }
+    summary << "detector,descriptor,matcher,selector,status,frames,mean_keypoints,mean_matches,"
+            << "mean_det_ms,mean_desc_ms,mean_match_ms,ttc_valid,ttc_mean_abs_step,ttc_mean_abs_lidar_diff" << endl;
+    frames << "detector,descriptor,matcher,selector,imgIndex,keypoints,matches,det_ms,desc_ms,match_ms,ttcCamera,ttcLidar" << endl;
+
+    /* LOOP OVER ALL COMBINATIONS */
+
+    for (auto det = detectorTypes.begin(); det != detectorTypes.end(); ++det)
+    {
+        for (auto desc = descriptorTypes.begin(); desc != descriptorTypes.end(); ++desc)
+        {
+            if (!isValidCombination(*det, *desc))
+            {
+                continue;
+            }
+
+            for (auto mat = matcherTypes.begin(); mat != matcherTypes.end(); ++mat)
+            {
+                for (auto sel = selectorTypes.begin(); sel != selectorTypes.end(); ++sel)
+                {
+                    cout << "Benchmarking " << *det << " / " << *desc << " / " << *mat << " / " << *sel << endl;
+
+                    vector<BenchmarkFrame> results;
+                    string status = "ok";
+                    RingBuffer<DataFrame> dataBuffer(2);
+                    try
+                    {
+                        for (auto it = sequence.begin(); it != sequence.end(); ++it)
+                        {
+                            // image and bounding boxes are shared with the prepared sequence, keypoint data is not
+                            DataFrame frame;
+                            frame.cameraImg = it->frame.cameraImg;
+                            frame.boundingBoxes = it->frame.boundingBoxes;
+                            dataBuffer.push(std::move(frame));
+                            DataFrame &curr = dataBuffer.current();
+
+                            BenchmarkFrame result;
+                            result.imgIndex = it->imgIndex;
+                            result.nMatches = 0;
+                            result.matchMs = NAN;
+                            result.ttcCamera = NAN;
+                            result.ttcLidar = NAN;
+
+                            cv::Mat imgGray;
+                            cv::cvtColor(curr.cameraImg, imgGray, cv::COLOR_BGR2GRAY);
+
+                            auto t = chrono::steady_clock::now();
+                            detKeypointsModern(curr.keypoints, imgGray, *det, false);
+                            result.detMs = elapsedMs(t);
+                            result.nKeypoints = curr.keypoints.size();
+                            buildKeypointBoxIndex(curr.keypoints, curr.boundingBoxes, curr.kptBoxes);
+
+                            t = chrono::steady_clock::now();
+                            descKeypoints(curr.keypoints, curr.cameraImg, curr.descriptors, *desc);
+                            result.descMs = elapsedMs(t);
+
+                            if (dataBuffer.size() > 1)
+                            {
+                                DataFrame &prev = dataBuffer.previous();
+
+                                t = chrono::steady_clock::now();
+                                matchDescriptors(prev.keypoints, curr.keypoints, prev.descriptors, curr.descriptors,
+                                                 curr.kptMatches, *mat, *sel);
+                                result.matchMs = elapsedMs(t);
+                                result.nMatches = curr.kptMatches.size();
+
+                                BoundingBox *prevBB = egoLaneObject(prev);
+                                BoundingBox *currBB = egoLaneObject(curr);
+                                if (prevBB != nullptr && currBB != nullptr)
+                                {
+                                    computeTTCLidar(prevBB->lidarPoints, currBB->lidarPoints, sensorFrameRate, result.ttcLidar);
+                                    clusterKptMatchesWithROI(curr.boundingBoxes, curr.kptBoxes, curr.keypoints, curr.kptMatches);
+                                    computeTTCCamera(prev.keypoints, curr.keypoints, currBB->kptMatches, sensorFrameRate, result.ttcCamera);
+                                }
+                            }
+                            results.push_back(result);
+                        }
+                    }
+                    catch (const cv::Exception &e)
+                    {
+                        status = "error"; // combination not supported by OpenCV
+                    }
+
+                    // aggregate per-frame results, the first frame has no matches and hence no TTC
+                    double sumKpts = 0, sumMatches = 0, sumDet = 0, sumDesc = 0, sumMatch = 0;
+                    double sumStep = 0, sumLidarDiff = 0, prevTTC = NAN;
+                    int nMatched = 0, nValid = 0, nSteps = 0, nLidar = 0;
+                    for (auto r = results.begin(); r != results.end(); ++r)
+                    {
+                        frames << *det << "," << *desc << "," << *mat << "," << *sel << "," << r->imgIndex << "," << r->nKeypoints << ","
+                               << r->nMatches << "," << r->detMs << "," << r->descMs << "," << r->matchMs << ","
+                               << r->ttcCamera << "," << r->ttcLidar << "\n";
+
+                        sumKpts += r->nKeypoints;
+                        sumDet += r->detMs;
+                        sumDesc += r->descMs;
+                        if (!std::isnan(r->matchMs))
+                        {
+                            sumMatches += r->nMatches;
+                            sumMatch += r->matchMs;
+                            ++nMatched;
+                        }
+
+                        // camera TTC is considered stable if it is finite, positive and changes little from frame to frame
+                        bool bValid = std::isfinite(r->ttcCamera) && r->ttcCamera > 0;
+                        if (bValid)
+                        {
+                            ++nValid;
+                            if (std::isfinite(prevTTC))
+                            {
+                                sumStep += fabs(r->ttcCamera - prevTTC);
+                                ++nSteps;
+                            }
+                            if (std::isfinite(r->ttcLidar))
+                            {
+                                sumLidarDiff += fabs(r->ttcCamera - r->ttcLidar);
+                                ++nLidar;
+                            }
+                        }
+                        prevTTC = bValid ? r->ttcCamera : NAN;
+                    }
+
+                    size_t n = results.size();
+                    summary << *det << "," << *desc << "," << *mat << "," << *sel << "," << status << "," << n << ","
+                            << (n > 0 ? sumKpts / n : NAN) << "," << (nMatched > 0 ? sumMatches / nMatched : NAN) << ","
+                            << (n > 0 ? sumDet / n : NAN) << "," << (n > 0 ? sumDesc / n : NAN) << ","
+                            << (nMatched > 0 ? sumMatch / nMatched : NAN) << "," << nValid << ","
+                            << (nSteps > 0 ? sumStep / nSteps : NAN) << "," << (nLidar > 0 ? sumLidarDiff / nLidar : NAN) << endl;
+                }
+            }
+        }
+    } // eof loop over all combinations
+
+    cout << "Benchmark results written to " << outputPrefix << "_summary.csv and " << outputPrefix << "_frames.csv" << endl;
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <vector>
 #include <cmath>
 #include <limits>
+#include <thread>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -15,10 +16,15 @@
 #include <opencv2/xfeatures2d/nonfree.hpp>
 
 #include "dataStructures.h"
+#include "ringBuffer.hpp"
+#include "pipeline.hpp"
+#include "threadPool.hpp"
+#include "framePrefetcher.hpp"
 #include "matching2D.hpp"
 #include "objectDetection2D.hpp"
 #include "lidarData.hpp"
 #include "camFusion.hpp"
+#include "timing.hpp"
 
 using namespace std;
 
@@ -68,134 +74,222 @@ int main(int argc, const char *argv[])
     P_rect_00.at<double>(1,0) = 0.000000e+00; P_rect_00.at<double>(1,1) = 7.215377e+02; P_rect_00.at<double>(1,2) = 1.728540e+02; P_rect_00.at<double>(1,3) = 0.000000e+00;
     P_rect_00.at<double>(2,0) = 0.000000e+00; P_rect_00.at<double>(2,1) = 0.000000e+00; P_rect_00.at<double>(2,2) = 1.000000e+00; P_rect_00.at<double>(2,3) = 0.000000e+00;    
 
+    // combined projection from Lidar into camera image coordinates
+    LidarProjector lidarProjector(P_rect_00, R_rect_00, RT);
+
     // misc
     double sensorFrameRate = 10.0 / imgStepWidth; // frames per second for Lidar and camera
     int dataBufferSize = 2;       // no. of images which are held in memory (ring buffer) at the same time
-    vector<DataFrame> dataBuffer; // list of data frames which are held in memory at the same time
+    RingBuffer<DataFrame> dataBuffer(dataBufferSize); // list of data frames which are held in memory at the same time
     bool bVis = false;            // visualize results
 
-    /* MAIN LOOP OVER ALL IMAGES */
-
-    for (size_t imgIndex = 0; imgIndex <= imgEndIndex - imgStartIndex; imgIndex+=imgStepWidth)
+    // command line : "--headless" never opens a window or waits for input, "--output <file>" writes the TTC results,
+    // "--timing <prefix>" records the duration of all processing stages and writes <prefix>.csv and <prefix>.json,
+    // "--exact-ttc" evaluates all keypoint pairs for the camera TTC instead of a sample of them
+    bool bHeadless = false;
+    bool bExactTTC = false;
+    string resultsFilename;
+    string timingPrefix;
+    for (int i = 1; i < argc; ++i)
     {
-        /* LOAD IMAGE INTO BUFFER */
+        string arg = argv[i];
+        if (arg == "--headless")
+        {
+            bHeadless = true;
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            resultsFilename = argv[++i];
+        }
+        else if (arg == "--timing" && i + 1 < argc)
+        {
+            timingPrefix = argv[++i];
+        }
+        else if (arg == "--exact-ttc")
+        {
+            bExactTTC = true;
+        }
+        else
+        {
+            cerr << "usage: " << argv[0] << " [--headless] [--output <file>] [--timing <prefix>] [--exact-ttc]" << endl;
+            return 1;
+        }
+    }
+    TimingRegistry::instance().setEnabled(!timingPrefix.empty());
 
-        // assemble filenames for current index
-        ostringstream imgNumber;
-        imgNumber << setfill('0') << setw(imgFillWidth) << imgStartIndex + imgIndex;
-        string imgFullFilename = imgBasePath + imgPrefix + imgNumber.str() + imgFileType;
+    if (bHeadless && resultsFilename.empty())
+    {
+        resultsFilename = "ttc_results.csv"; // batch runs always leave their results behind
+    }
 
-        // load image from file 
-        cv::Mat img = cv::imread(imgFullFilename);
+    ofstream results;
+    if (!resultsFilename.empty())
+    {
+        results.open(resultsFilename.c_str());
+        if (!results)
+        {
+            cerr << "cannot open results file " << resultsFilename << endl;
+            return 1;
+        }
+        results << "imgIndex,prevBoxID,currBoxID,lidarPoints,kptMatches,ttcLidar,ttcCamera" << endl;
+    }
 
-        // push image into data frame buffer
-        DataFrame frame;
-        frame.cameraImg = img;
-        dataBuffer.push_back(frame);
+    /* LOAD OBJECT DETECTOR */
 
-        cout << "#1 : LOAD IMAGE #" << imgIndex << " INTO BUFFER done" << endl;
+    // the network, the class names and the output layer names are loaded once and reused for all images
+    float confThreshold = 0.2;
+    float nmsThreshold = 0.4;
+    ObjectDetector objectDetector(yoloClassesFile, yoloModelConfiguration, yoloModelWeights, confThreshold, nmsThreshold);
 
+    cout << "#0 : LOAD OBJECT DETECTOR done in " << 1000 * objectDetector.loadTime() << " ms" << endl;
 
-        /* DETECT & CLASSIFY OBJECTS */
+    // Lidar cropping and clustering
+    float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1; // focus on ego lane
+    float shrinkFactor = 0.10; // shrinks each bounding box by the given percentage to avoid 3D object merging at the edges of an ROI
+    bool bOneToOneBoxes = true; // every bounding box is associated with at most one box of the other frame
+    double closestPercentile = 0.05; // Lidar TTC uses the point at this percentile of the x-distances instead of the closest one
+    size_t maxCameraPairs = 50000; // camera TTC samples this many keypoint pairs at most instead of evaluating all of them
 
-        float confThreshold = 0.2;
-        float nmsThreshold = 0.4;        
-        detectObjects((dataBuffer.end() - 1)->cameraImg, (dataBuffer.end() - 1)->boundingBoxes, confThreshold, nmsThreshold,
-                      yoloBasePath, yoloClassesFile, yoloModelConfiguration, yoloModelWeights, bVis);
+    // keypoint detection, description and matching
+    string detectorType = "SHITOMASI";   // SHITOMASI, HARRIS, FAST, BRISK, ORB, AKAZE, SIFT
+    string descriptorType = "FREAK";     // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
+    string matcherType = "MAT_BF";       // MAT_BF, MAT_FLANN
+    string selectorType = "SEL_NN";      // SEL_NN, SEL_KNN
+    bool bLimitKpts = false;             // optional : limit number of keypoints (helpful for debugging and learning)
 
-        cout << "#2 : DETECT & CLASSIFY OBJECTS done" << endl;
+    /* SET UP FRAME PIPELINE */
 
+    // camera images and Lidar scans of the next frames are read and decoded in the background
+    size_t prefetchDepth = 3; // no. of frames which are loaded ahead of the one being processed
+    FramePrefetcher prefetcher(imgBasePath, imgPrefix, imgFileType, lidarPrefix, lidarFileType,
+                               imgStartIndex, imgEndIndex, imgStepWidth, imgFillWidth, prefetchDepth);
 
-        /* CROP LIDAR POINTS */
+    // worker threads which execute the independent branches of a single frame at the same time
+    ThreadPool threadPool(max(2u, thread::hardware_concurrency()));
 
-        // load 3D Lidar points from file
-        string lidarFullFilename = imgBasePath + lidarPrefix + imgNumber.str() + lidarFileType;
-        std::vector<LidarPoint> lidarPoints;
-        loadLidarFromFile(lidarPoints, lidarFullFilename);
+    // every stage runs on its own thread and works on a different frame, i.e. frame N+1 is loaded and classified
+    // while frame N is still being matched; frames leave the pipeline in the order in which they were loaded
+    size_t pipelineQueueSize = 2; // no. of frames which may wait in front of each stage
+    Pipeline<FrameJob> pipeline(pipelineQueueSize);
 
-        // remove Lidar points based on distance properties
-        float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1; // focus on ego lane
-        cropLidarPoints(lidarPoints, minX, maxX, maxY, minZ, maxZ, minR);
-    
-        (dataBuffer.end() - 1)->lidarPoints = lidarPoints;
+    pipeline.addStage("perceive", [&](FrameJob &job) {
 
-        cout << "#3 : CROP LIDAR POINTS done" << endl;
+        TIME_SCOPE("main/perceive");
 
+        // the Lidar branch (crop) and the camera branch (grayscale -> keypoints -> descriptors) are independent
+        // of each other and of the object detection, hence all three run concurrently; clustering joins the Lidar
+        // branch with the bounding boxes, the camera branch is only needed once the frame leaves this stage
+        DataFrame &frame = job.frame;
+        TaskGroup tasks(threadPool);
 
-        /* CLUSTER LIDAR POINT CLOUD */
+        size_t lidarTask = tasks.run([&] {
 
-        // associate Lidar points with camera-based ROI
-            cout << "3D Objects";
+            TIME_SCOPE("main/lidarBranch");
 
-        float shrinkFactor = 0.10; // shrinks each bounding box by the given percentage to avoid 3D object merging at the edges of an ROI
-        clusterLidarWithROI((dataBuffer.end()-1)->boundingBoxes, (dataBuffer.end() - 1)->lidarPoints, shrinkFactor, P_rect_00, R_rect_00, RT);
+            /* LOAD AND CROP LIDAR POINTS */
 
-        // Visualize 3D objects
-        bVis = false;
-        if(bVis)
-        {
-            show3DObjects((dataBuffer.end()-1)->boundingBoxes, cv::Size(4.0, 20.0), cv::Size(2000, 2000), true);
-        }
-        bVis = false;
+            // read points from the mapped scan and keep only those matching the distance properties
+            loadLidarFromScan(frame.lidarPoints, frame.lidarScan, minX, maxX, maxY, minZ, maxZ, minR);
 
-        cout << "#4 : CLUSTER LIDAR POINT CLOUD done" << endl;
-        
-        
-        // REMOVE THIS LINE BEFORE PROCEEDING WITH THE FINAL PROJECT
-        //continue; // skips directly to the next image without processing what comes beneath
+            cout << "#3 : CROP LIDAR POINTS #" << job.imgIndex << " done" << endl;
+        });
 
-        /* DETECT IMAGE KEYPOINTS */
+        size_t cameraTask = tasks.run([&] {
 
-        // convert current image to grayscale
-        cv::Mat imgGray;
-        cv::cvtColor((dataBuffer.end()-1)->cameraImg, imgGray, cv::COLOR_BGR2GRAY);
+            TIME_SCOPE("main/cameraBranch");
 
-        // extract 2D keypoints from current image
-        vector<cv::KeyPoint> keypoints; // create empty feature list for current image
-        string detectorType = "SHITOMASI";
+            /* DETECT IMAGE KEYPOINTS */
 
-        //if (detectorType.compare("SHITOMASI") == 0)
-        //{
-         detKeypointsModern(keypoints, imgGray,detectorType, false);
-      
+            // convert current image to grayscale
+            cv::Mat imgGray;
+            cv::cvtColor(frame.cameraImg, imgGray, cv::COLOR_BGR2GRAY);
 
-        //}
-        //else
-        //{
-            //...
-        //}
+            // extract 2D keypoints from current image
+            vector<cv::KeyPoint> keypoints; // create empty feature list for current image
+            detKeypointsModern(keypoints, imgGray, detectorType, false);
 
-        // optional : limit number of keypoints (helpful for debugging and learning)
-        bool bLimitKpts = false;
-        if (bLimitKpts)
-        {
-            int maxKeypoints = 50;
+            // optional : limit number of keypoints (helpful for debugging and learning)
+            if (bLimitKpts)
+            {
+                int maxKeypoints = 50;
 
-            if (detectorType.compare("SHITOMASI") == 0)
-            { // there is no response info, so keep the first 50 as they are sorted in descending quality order
-                keypoints.erase(keypoints.begin() + maxKeypoints, keypoints.end());
+                if (detectorType.compare("SHITOMASI") == 0)
+                { // there is no response info, so keep the first 50 as they are sorted in descending quality order
+                    keypoints.erase(keypoints.begin() + min(maxKeypoints, (int)keypoints.size()), keypoints.end());
+                }
+                cv::KeyPointsFilter::retainBest(keypoints, maxKeypoints);
+                cout << " NOTE: Keypoints have been limited!" << endl;
             }
-            cv::KeyPointsFilter::retainBest(keypoints, maxKeypoints);
-            cout << " NOTE: Keypoints have been limited!" << endl;
-        }
 
-        // push keypoints and descriptor for current frame to end of data buffer
-        (dataBuffer.end() - 1)->keypoints = keypoints;
+            // store keypoints for current frame
+            frame.keypoints = std::move(keypoints);
+
+            cout << "#5 : DETECT KEYPOINTS #" << job.imgIndex << " done" << endl;
+
+
+            /* EXTRACT KEYPOINT DESCRIPTORS */
+
+            cv::Mat descriptors;
+            descKeypoints(frame.keypoints, frame.cameraImg, descriptors, descriptorType);
+
+            // store descriptors for current frame
+            frame.descriptors = descriptors;
+
+            cout << "#6 : EXTRACT DESCRIPTORS #" << job.imgIndex << " done" << endl;
+        });
+
+        /* DETECT & CLASSIFY OBJECTS */
+
+        objectDetector.detect(frame.cameraImg, frame.boundingBoxes, false);
+
+        cout << "#2 : DETECT & CLASSIFY OBJECTS #" << job.imgIndex << " done in " << 1000 * objectDetector.detectTime() << " ms" << endl;
+
+
+        /* CLUSTER LIDAR POINT CLOUD */
+
+        // associate Lidar points with camera-based ROI
+        tasks.join(lidarTask);
+        clusterLidarWithROI(frame.boundingBoxes, frame.lidarPoints, shrinkFactor, lidarProjector);
+
+        cout << "#4 : CLUSTER LIDAR POINT CLOUD #" << job.imgIndex << " done" << endl;
+
+        tasks.join(cameraTask);
+
+        // look up once which bounding boxes enclose each keypoint
+        buildKeypointBoxIndex(frame.keypoints, frame.boundingBoxes, frame.kptBoxes);
+    });
 
-        cout << "#5 : DETECT KEYPOINTS done" << endl;
+    /* MAIN LOOP OVER ALL IMAGES */
+
+    auto loadFrame = [&](FrameJob &job) {
 
+        /* LOAD IMAGE INTO BUFFER */
+
+        // take the next camera image and Lidar scan from the prefetcher
+        TIME_SCOPE("main/waitForFrame");
+        if (!prefetcher.next(job))
+        {
+            return false; // no more images
+        }
 
-        /* EXTRACT KEYPOINT DESCRIPTORS */
+        cout << "#1 : LOAD IMAGE #" << job.imgIndex << " done" << endl;
+        return true;
+    };
 
-        cv::Mat descriptors;
-        string descriptorType = "FREAK"; // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
-        descKeypoints((dataBuffer.end() - 1)->keypoints, (dataBuffer.end() - 1)->cameraImg, descriptors, descriptorType);
+    auto processFrame = [&](FrameJob &job) {
 
-        // push descriptors for current frame to end of data buffer
-        (dataBuffer.end() - 1)->descriptors = descriptors;
+        TIME_SCOPE("main/processFrame");
 
-        cout << "#6 : EXTRACT DESCRIPTORS done" << endl;
+        // push frame into data frame buffer (recycles the slot of the oldest frame)
+        dataBuffer.push(std::move(job.frame));
 
+        // Visualize 3D objects
+        bVis = false;
+        if(bVis)
+        {
+            show3DObjects(dataBuffer.current().boundingBoxes, cv::Size(4.0, 20.0), cv::Size(2000, 2000), true);
+        }
+        bVis = false;
 
         if (dataBuffer.size() > 1) // wait until at least two images have been processed
         {
@@ -203,18 +297,14 @@ int main(int argc, const char *argv[])
             /* MATCH KEYPOINT DESCRIPTORS */
 
             vector<cv::DMatch> matches;
-            string matcherType = "MAT_BF";        // MAT_BF, MAT_FLANN
-            string descriptorType = "DES_BINARY"; // DES_BINARY, DES_HOG
-            string selectorType = "SEL_NN";       // SEL_NN, SEL_KNN
-
-            matchDescriptors((dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints,
-                             (dataBuffer.end() - 2)->descriptors, (dataBuffer.end() - 1)->descriptors,
-                             matches, descriptorType, matcherType, selectorType);
+            matchDescriptors(dataBuffer.previous().keypoints, dataBuffer.current().keypoints,
+                             dataBuffer.previous().descriptors, dataBuffer.current().descriptors,
+                             matches, matcherType, selectorType);
 
             // store matches in current data frame
-            (dataBuffer.end() - 1)->kptMatches = matches;
+            dataBuffer.current().kptMatches = std::move(matches);
 
-            cout << "#7 : MATCH KEYPOINT DESCRIPTORS done" << endl;
+            cout << "#7 : MATCH KEYPOINT DESCRIPTORS #" << job.imgIndex << " done" << endl;
 
             
             /* TRACK 3D OBJECT BOUNDING BOXES */
@@ -222,7 +312,10 @@ int main(int argc, const char *argv[])
             //// STUDENT ASSIGNMENT
             //// TASK FP.1 -> match list of 3D objects (vector<BoundingBox>) between current and previous frame (implement ->matchBoundingBoxes)
             map<int, int> bbBestMatches;
-            matchBoundingBoxes(matches, bbBestMatches, *(dataBuffer.end()-2), *(dataBuffer.end()-1)); // associate bounding boxes between current and previous frame using keypoint matches
+            matchBoundingBoxes(dataBuffer.current().kptMatches, bbBestMatches, dataBuffer.previous(), dataBuffer.current(), bOneToOneBoxes); // associate bounding boxes between current and previous frame using keypoint matches
+
+            // assign enclosed keypoint matches to all bounding boxes of the current frame
+            clusterKptMatchesWithROI(dataBuffer.current().boundingBoxes, dataBuffer.current().kptBoxes, dataBuffer.current().keypoints, dataBuffer.current().kptMatches);
             //// EOF STUDENT ASSIGNMENT
             if (1){
                 for (auto const& pair: bbBestMatches) {
@@ -230,22 +323,25 @@ int main(int argc, const char *argv[])
                 }
             }
 
-            cin.get();
+            if (!bHeadless)
+            {
+                cin.get();
+            }
 
             // store matches in current data frame
-            (dataBuffer.end()-1)->bbMatches = bbBestMatches;
-
-            cout << "#8 : TRACK 3D OBJECT BOUNDING BOXES done" << endl;
+            dataBuffer.current().bbMatches = bbBestMatches;
 
+            cout << "#8 : TRACK 3D OBJECT BOUNDING BOXES #" << job.imgIndex << " done" << endl;
 
             /* COMPUTE TTC ON OBJECT IN FRONT */
+            TIME_SCOPE("main/computeTTC");
             int count_bb_match = 0;
             // loop over all BB match pairs
-            for (auto it1 = (dataBuffer.end() - 1)->bbMatches.begin(); it1 != (dataBuffer.end() - 1)->bbMatches.end(); ++it1)
+            for (auto it1 = dataBuffer.current().bbMatches.begin(); it1 != dataBuffer.current().bbMatches.end(); ++it1)
             {
                 // find bounding boxes associates with current match
                 BoundingBox *prevBB, *currBB;
-                for (auto it2 = (dataBuffer.end() - 1)->boundingBoxes.begin(); it2 != (dataBuffer.end() - 1)->boundingBoxes.end(); ++it2)
+                for (auto it2 = dataBuffer.current().boundingBoxes.begin(); it2 != dataBuffer.current().boundingBoxes.end(); ++it2)
                 {
                     if (it1->second == it2->boxID) // check wether current match partner corresponds to this BB
                     {
@@ -253,7 +349,7 @@ int main(int argc, const char *argv[])
                     }
                 }
 
-                for (auto it2 = (dataBuffer.end() - 2)->boundingBoxes.begin(); it2 != (dataBuffer.end() - 2)->boundingBoxes.end(); ++it2)
+                for (auto it2 = dataBuffer.previous().boundingBoxes.begin(); it2 != dataBuffer.previous().boundingBoxes.end(); ++it2)
                 {
                     if (it1->first == it2->boxID) // check wether current match partner corresponds to this BB
                     {
@@ -262,7 +358,7 @@ int main(int argc, const char *argv[])
                 }
 
                 // compute TTC for current match
-                cout << "Check if lidar points for CurrBB & prevBB.  CurrBB " CurrBB.boxID " has lidar poitns " << currBB->lidarPoints.size() << "; prevBB " prevBB.boxID "has lidar poitns" << prevBB->lidarPoints.size() << endl;                
+                cout << "Check if lidar points for CurrBB & prevBB.  CurrBB " << currBB->boxID << " has lidar poitns " << currBB->lidarPoints.size() << "; prevBB " << prevBB->boxID << " has lidar poitns " << prevBB->lidarPoints.size() << endl;                
                 if( currBB->lidarPoints.size()>0 && prevBB->lidarPoints.size()>0 ) // only compute TTC if we have Lidar points
                 {
                     count_bb_match++;
@@ -277,25 +373,37 @@ int main(int argc, const char *argv[])
                     //// STUDENT ASSIGNMENT
                     //// TASK FP.2 -> compute time-to-collision based on Lidar data (implement -> computeTTCLidar)
                     double ttcLidar; 
-                    computeTTCLidar(prevBB->lidarPoints, currBB->lidarPoints, sensorFrameRate, ttcLidar);
+                    computeTTCLidar(prevBB->lidarPoints, currBB->lidarPoints, sensorFrameRate, ttcLidar, closestPercentile);
                     //// EOF STUDENT ASSIGNMENT
 
                     //// STUDENT ASSIGNMENT
                     //// TASK FP.3 -> assign enclosed keypoint matches to bounding box (implement -> clusterKptMatchesWithROI)
                     //// TASK FP.4 -> compute time-to-collision based on camera (implement -> computeTTCCamera)
                     double ttcCamera;
-                    clusterKptMatchesWithROI(*currBB, (dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints, (dataBuffer.end() - 1)->kptMatches);                    
                     //    cout << "Check bounding box x = " << currBB->roi.x << " y =  " << currBB->roi.y << endl;
                     
-                    computeTTCCamera((dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints, currBB->kptMatches, sensorFrameRate, ttcCamera);
+                    if (bExactTTC)
+                    {
+                        computeTTCCameraExact(dataBuffer.previous().keypoints, dataBuffer.current().keypoints, currBB->kptMatches, sensorFrameRate, ttcCamera);
+                    }
+                    else
+                    {
+                        computeTTCCamera(dataBuffer.previous().keypoints, dataBuffer.current().keypoints, currBB->kptMatches, sensorFrameRate, ttcCamera, nullptr, maxCameraPairs);
+                    }
                     //// EOF STUDENT ASSIGNMENT
 
-                    bVis = true;
+                    if (results.is_open())
+                    {
+                        results << job.imgIndex << "," << prevBB->boxID << "," << currBB->boxID << "," << currBB->lidarPoints.size() << ","
+                                << currBB->kptMatches.size() << "," << ttcLidar << "," << ttcCamera << "\n";
+                    }
+
+                    bVis = !bHeadless;
                     if (bVis)
                     {
-                        cv::Mat visImg = (dataBuffer.end() - 1)->cameraImg.clone();
+                        cv::Mat visImg = dataBuffer.current().cameraImg.clone();
 
-                        showLidarImgOverlay(visImg, currBB->lidarPoints, P_rect_00, R_rect_00, RT, &visImg);
+                        showLidarImgOverlay(visImg, currBB->lidarPoints, lidarProjector, &visImg);
                         cv::rectangle(visImg, cv::Point(currBB->roi.x, currBB->roi.y), cv::Point(currBB->roi.x + currBB->roi.width, currBB->roi.y + currBB->roi.height), cv::Scalar(0, 255, 0), 2);
                         
                         char str[200];
@@ -315,7 +423,25 @@ int main(int argc, const char *argv[])
 
         }
 
-    } // eof loop over all images
+    };
+
+    double t = (double)cv::getTickCount();
+    pipeline.run(loadFrame, processFrame);
+    t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+
+    size_t nFrames = (imgEndIndex - imgStartIndex) / imgStepWidth + 1;
+    cout << "Processed " << nFrames << " frames in " << 1000 * t << " ms (" << nFrames / t << " frames/s)" << endl;
+
+    if (results.is_open())
+    {
+        cout << "TTC results written to " << resultsFilename << endl;
+    }
+
+    if (!timingPrefix.empty())
+    {
+        bool bWritten = TimingRegistry::instance().writeCsv(timingPrefix + ".csv") && TimingRegistry::instance().writeJson(timingPrefix + ".json");
+        cout << (bWritten ? "Stage timings written to " : "Cannot write stage timings to ") << timingPrefix << ".csv/.json" << endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,46 @@
+
+#ifndef alignedAllocator_hpp
+#define alignedAllocator_hpp
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+
+// std::allocator replacement which aligns every allocation to 'Alignment' bytes (e.g. 64 for cache lines and AVX-512)
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+        // over-allocate and keep the original pointer right in front of the aligned block
+        void *raw = malloc(n * sizeof(T) + Alignment + sizeof(void *));
+        if (raw == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        uintptr_t aligned = ((uintptr_t)raw + sizeof(void *) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+        ((void **)aligned)[-1] = raw;
+        return (T *)aligned;
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        if (p != nullptr)
+        {
+            free(((void **)p)[-1]);
+        }
+    }
+};
+
+template <typename T, typename U, size_t A>
+bool operator==(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return true; }
+template <typename T, typename U, size_t A>
+bool operator!=(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return false; }
+
+#endif /* alignedAllocator_hpp */
@@ -0,0 +1,384 @@
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "bruteForceMatcher.hpp"
+#include "timing.hpp"
+
+using namespace std;
+
+void BinaryDescriptors::pack(const cv::Mat &descriptors)
+{
+    size_t cols = descriptors.cols;
+    rows = descriptors.rows;
+    stride = max((size_t)64, (cols + 63) / 64 * 64);
+    data.assign(rows * stride, 0);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        memcpy(data.data() + i * stride, descriptors.ptr<uint8_t>(i), cols);
+    }
+}
+
+// the vector kernels (Hamming and L2) need x86-64 (64-bit lane extracts), 32-bit x86 builds use the portable kernels
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MATCHER_X86 1
+#endif
+
+// Every instruction set has a distance kernel for one pair of packed rows, which is used as it is for single pairs
+// and inlined into a row kernel comparing one query row with all train rows.
+typedef void (*HammingRowKernel)(const uint8_t *query, const BinaryDescriptors &train, Top2<uint32_t> &top2);
+
+// portable kernel, the compiler lowers the popcount for the baseline target
+static inline __attribute__((always_inline)) uint32_t hammingPairScalar(const uint8_t *a, const uint8_t *b, size_t nBytes)
+{
+    const uint64_t *x = (const uint64_t *)a, *y = (const uint64_t *)b;
+    uint32_t dist = 0;
+    for (size_t w = 0; w < nBytes / 8; ++w)
+    {
+        dist += __builtin_popcountll(x[w] ^ y[w]);
+    }
+    return dist;
+}
+
+static void hammingRowScalar(const uint8_t *query, const BinaryDescriptors &train, Top2<uint32_t> &top2)
+{
+    for (size_t t = 0; t < train.rows; ++t)
+    {
+        top2.update(hammingPairScalar(query, train.row(t), train.stride), t);
+    }
+}
+
+#ifdef MATCHER_X86
+
+// same loop with the popcnt instruction
+__attribute__((target("popcnt"))) static uint32_t hammingPairPopcnt(const uint8_t *a, const uint8_t *b, size_t nBytes)
+{
+    return hammingPairScalar(a, b, nBytes);
+}
+
+__attribute__((target("popcnt"))) static void hammingRowPopcnt(const uint8_t *query, const BinaryDescriptors &train, Top2<uint32_t> &top2)
+{
+    for (size_t t = 0; t < train.rows; ++t)
+    {
+        top2.update(hammingPairScalar(query, train.row(t), train.stride), t);
+    }
+}
+
+// per-byte popcount with a nibble lookup table, summed up per 64-bit lane
+static inline __attribute__((target("avx2"), always_inline)) uint32_t hammingPairAvx2(const uint8_t *a, const uint8_t *b, size_t nBytes)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    for (size_t c = 0; c < nBytes; c += 32)
+    {
+        __m256i x = _mm256_xor_si256(_mm256_load_si256((const __m256i *)(a + c)), _mm256_load_si256((const __m256i *)(b + c)));
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, lowNibble)),
+                                      _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), lowNibble)));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(cnt, zero));
+    }
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    return (uint32_t)(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+
+__attribute__((target("avx2"))) static void hammingRowAvx2(const uint8_t *query, const BinaryDescriptors &train, Top2<uint32_t> &top2)
+{
+    for (size_t t = 0; t < train.rows; ++t)
+    {
+        top2.update(hammingPairAvx2(query, train.row(t), train.stride), t);
+    }
+}
+
+static inline __attribute__((target("avx512f,avx512vpopcntdq"), always_inline)) uint32_t hammingPairAvx512(const uint8_t *a, const uint8_t *b, size_t nBytes)
+{
+    __m512i sum = _mm512_setzero_si512();
+    for (size_t c = 0; c < nBytes; c += 64)
+    {
+        __m512i x = _mm512_xor_si512(_mm512_load_si512(a + c), _mm512_load_si512(b + c));
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+    }
+    // the lanes are added up by hand, _mm512_reduce_add_epi64 trips -Wuninitialized in the GCC 12 headers
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, sum);
+    return (uint32_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7]);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) static void hammingRowAvx512(const uint8_t *query, const BinaryDescriptors &train, Top2<uint32_t> &top2)
+{
+    for (size_t t = 0; t < train.rows; ++t)
+    {
+        top2.update(hammingPairAvx512(query, train.row(t), train.stride), t);
+    }
+}
+
+#endif
+
+// the widest Hamming kernels supported by the CPU we are running on
+struct HammingKernels
+{
+    HammingRowKernel row;
+    HammingPairKernel pair;
+};
+
+static const HammingKernels &hammingKernels()
+{
+    static const HammingKernels kernels = [] {
+#ifdef MATCHER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512vpopcntdq"))
+        {
+            return HammingKernels{hammingRowAvx512, hammingPairAvx512};
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return HammingKernels{hammingRowAvx2, hammingPairAvx2};
+        }
+        if (__builtin_cpu_supports("popcnt"))
+        {
+            return HammingKernels{hammingRowPopcnt, hammingPairPopcnt};
+        }
+#endif
+        return HammingKernels{hammingRowScalar, hammingPairScalar};
+    }();
+    return kernels;
+}
+
+HammingPairKernel hammingPairKernel()
+{
+    return hammingKernels().pair;
+}
+
+void matchBinaryTop2(const cv::Mat &descQuery, const cv::Mat &descTrain, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second)
+{
+    TIME_SCOPE("bruteForceMatcher/matchBinaryTop2");
+
+    // the packed copies are reused from call to call
+    static thread_local BinaryDescriptors queryBuffer, trainBuffer;
+    BinaryDescriptors &query = queryBuffer, &train = trainBuffer;
+    query.pack(descQuery);
+    train.pack(descTrain);
+
+    best.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    second.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    if (train.rows == 0)
+    {
+        return;
+    }
+
+    // query rows are split into stripes which run in parallel, every row writes its own result
+    HammingRowKernel kernel = hammingKernels().row;
+    int nStripes = min((int)query.rows, 64);
+    cv::parallel_for_(cv::Range(0, (int)query.rows), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; ++i)
+        {
+            Top2<uint32_t> top2;
+            kernel(query.row(i), train, top2);
+            best[i] = cv::DMatch(i, top2.idx1, (float)top2.dist1);
+            if (top2.idx2 >= 0)
+            {
+                second[i] = cv::DMatch(i, top2.idx2, (float)top2.dist2);
+            }
+        }
+    }, nStripes);
+}
+
+
+void FloatDescriptors::pack(const cv::Mat &descriptors)
+{
+    size_t cols = descriptors.cols;
+    rows = descriptors.rows;
+    stride = max((size_t)16, (cols + 15) / 16 * 16);
+    data.assign(rows * stride, 0.0f);
+    sqrNorms.resize(rows);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        float *dst = data.data() + i * stride;
+        memcpy(dst, descriptors.ptr<float>(i), cols * sizeof(float));
+
+        float sqrNorm = 0.0f;
+        for (size_t c = 0; c < cols; ++c)
+        {
+            sqrNorm += dst[c] * dst[c];
+        }
+        sqrNorms[i] = sqrNorm;
+    }
+}
+
+// The distances are computed like a matrix product : |q - t|^2 = |q|^2 + |t|^2 - 2 q.t, where a block of 4 query rows
+// is multiplied with one train row at a time, so every train row is loaded once per block instead of once per query.
+// The kernels process the train rows [t0, t1) for the query rows q[0..3] and update their top-2 lists right away.
+typedef void (*L2BlockKernel)(const float *const q[4], const float qNorm[4], const FloatDescriptors &train, size_t t0, size_t t1, Top2<float> top2[4]);
+
+static void l2BlockScalar(const float *const q[4], const float qNorm[4], const FloatDescriptors &train, size_t t0, size_t t1, Top2<float> top2[4])
+{
+    for (size_t t = t0; t < t1; ++t)
+    {
+        const float *d = train.row(t);
+        float dot[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (size_t c = 0; c < train.stride; ++c)
+        {
+            dot[0] += q[0][c] * d[c]; dot[1] += q[1][c] * d[c]; dot[2] += q[2][c] * d[c]; dot[3] += q[3][c] * d[c];
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            top2[k].update(max(0.0f, qNorm[k] + train.sqrNorms[t] - 2.0f * dot[k]), t);
+        }
+    }
+}
+
+#ifdef MATCHER_X86
+
+static inline float horizontalSum(__m256 v) __attribute__((target("avx2")));
+static inline float horizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma"))) static void l2BlockAvx2(const float *const q[4], const float qNorm[4], const FloatDescriptors &train, size_t t0, size_t t1, Top2<float> top2[4])
+{
+    for (size_t t = t0; t < t1; ++t)
+    {
+        const float *d = train.row(t);
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (size_t c = 0; c < train.stride; c += 8)
+        {
+            __m256 v = _mm256_load_ps(d + c);
+            acc0 = _mm256_fmadd_ps(_mm256_load_ps(q[0] + c), v, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_load_ps(q[1] + c), v, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_load_ps(q[2] + c), v, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_load_ps(q[3] + c), v, acc3);
+        }
+        float dot[4] = {horizontalSum(acc0), horizontalSum(acc1), horizontalSum(acc2), horizontalSum(acc3)};
+        for (int k = 0; k < 4; ++k)
+        {
+            top2[k].update(max(0.0f, qNorm[k] + train.sqrNorms[t] - 2.0f * dot[k]), t);
+        }
+    }
+}
+
+// the lanes are added up by hand, _mm512_reduce_add_ps trips -Wmaybe-uninitialized in the GCC 12 headers
+static inline float horizontalSum512(__m512 v) __attribute__((target("avx512f")));
+static inline float horizontalSum512(__m512 v)
+{
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, v);
+    float sum = 0.0f;
+    for (int k = 0; k < 16; ++k)
+    {
+        sum += lanes[k];
+    }
+    return sum;
+}
+
+__attribute__((target("avx512f"))) static void l2BlockAvx512(const float *const q[4], const float qNorm[4], const FloatDescriptors &train, size_t t0, size_t t1, Top2<float> top2[4])
+{
+    for (size_t t = t0; t < t1; ++t)
+    {
+        const float *d = train.row(t);
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (size_t c = 0; c < train.stride; c += 16)
+        {
+            __m512 v = _mm512_load_ps(d + c);
+            acc0 = _mm512_fmadd_ps(_mm512_load_ps(q[0] + c), v, acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_load_ps(q[1] + c), v, acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_load_ps(q[2] + c), v, acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_load_ps(q[3] + c), v, acc3);
+        }
+        float dot[4] = {horizontalSum512(acc0), horizontalSum512(acc1), horizontalSum512(acc2), horizontalSum512(acc3)};
+        for (int k = 0; k < 4; ++k)
+        {
+            top2[k].update(max(0.0f, qNorm[k] + train.sqrNorms[t] - 2.0f * dot[k]), t);
+        }
+    }
+}
+
+#endif
+
+// picks the widest L2 kernel supported by the CPU we are running on
+static L2BlockKernel l2BlockKernel()
+{
+#ifdef MATCHER_X86
+    static const L2BlockKernel kernel = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return (L2BlockKernel)l2BlockAvx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            return (L2BlockKernel)l2BlockAvx2;
+        }
+        return (L2BlockKernel)l2BlockScalar;
+    }();
+    return kernel;
+#else
+    return l2BlockScalar;
+#endif
+}
+
+void matchFloatTop2(const cv::Mat &descQuery, const cv::Mat &descTrain, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second)
+{
+    TIME_SCOPE("bruteForceMatcher/matchFloatTop2");
+
+    static thread_local FloatDescriptors queryBuffer, trainBuffer;
+    FloatDescriptors &query = queryBuffer, &train = trainBuffer;
+    query.pack(descQuery);
+    train.pack(descTrain);
+
+    best.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    second.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    if (train.rows == 0 || query.rows == 0)
+    {
+        return;
+    }
+
+    // blocks of 4 query rows are split into stripes which run in parallel; every stripe walks through the train rows
+    // in tiles and multiplies all its blocks with a tile before moving on, so the tile stays in cache
+    L2BlockKernel kernel = l2BlockKernel();
+    const size_t blockRows = 4, tileRows = 256;
+    int nBlocks = (query.rows + blockRows - 1) / blockRows;
+    cv::parallel_for_(cv::Range(0, nBlocks), [&](const cv::Range &range) {
+        vector<Top2<float>> top2((range.end - range.start) * blockRows);
+        for (size_t t0 = 0; t0 < train.rows; t0 += tileRows)
+        {
+            for (int b = range.start; b < range.end; ++b)
+            {
+                // a partial last block repeats its first row, the extra results are dropped
+                size_t q0 = b * blockRows, nq = min(blockRows, query.rows - q0);
+                const float *q[4];
+                float qNorm[4];
+                for (size_t k = 0; k < blockRows; ++k)
+                {
+                    size_t i = q0 + (k < nq ? k : 0);
+                    q[k] = query.row(i);
+                    qNorm[k] = query.sqrNorms[i];
+                }
+                kernel(q, qNorm, train, t0, min(train.rows, t0 + tileRows), &top2[(b - range.start) * blockRows]);
+            }
+        }
+
+        for (int b = range.start; b < range.end; ++b)
+        {
+            size_t q0 = b * blockRows, nq = min(blockRows, query.rows - q0);
+            for (size_t k = 0; k < nq; ++k)
+            {
+                const Top2<float> &t = top2[(b - range.start) * blockRows + k];
+                int i = q0 + k;
+                best[i] = cv::DMatch(i, t.idx1, sqrt(t.dist1));
+                if (t.idx2 >= 0)
+                {
+                    second[i] = cv::DMatch(i, t.idx2, sqrt(t.dist2));
+                }
+            }
+        }
+    }, min(nBlocks, 64));
+}
@@ -0,0 +1,73 @@
+
+#ifndef bruteForceMatcher_hpp
+#define bruteForceMatcher_hpp
+
+#include <stdint.h>
+#include <vector>
+#include <limits>
+#include <opencv2/core.hpp>
+
+#include "alignedAllocator.hpp"
+
+// binary descriptors (one per row of a CV_8U matrix) copied into one contiguous block whose rows are zero-padded to a
+// multiple of 64 bytes, so the distance kernels always work on full, aligned vectors
+struct BinaryDescriptors
+{
+    size_t rows;   // no. of descriptors
+    size_t stride; // bytes per padded row
+    std::vector<uint8_t, AlignedAllocator<uint8_t, 64>> data;
+
+    void pack(const cv::Mat &descriptors);
+    const uint8_t *row(size_t i) const { return data.data() + i * stride; }
+};
+
+// float descriptors (one per row of a CV_32F matrix) in the same padded layout, together with their squared L2 norms
+struct FloatDescriptors
+{
+    size_t rows;   // no. of descriptors
+    size_t stride; // floats per padded row
+    std::vector<float, AlignedAllocator<float, 64>> data;
+    std::vector<float> sqrNorms;
+
+    void pack(const cv::Mat &descriptors);
+    const float *row(size_t i) const { return data.data() + i * stride; }
+};
+
+// nearest and second nearest neighbour found so far; equal distances are resolved towards the lower train index, so
+// the result does not depend on the order in which the candidates are visited
+template <typename Distance>
+struct Top2
+{
+    Distance dist1, dist2;
+    int idx1, idx2;
+
+    Top2() : dist1(std::numeric_limits<Distance>::max()), dist2(std::numeric_limits<Distance>::max()), idx1(-1), idx2(-1) {}
+
+    void update(Distance dist, int idx)
+    {
+        if (dist < dist1 || (dist == dist1 && idx < idx1))
+        {
+            dist2 = dist1; idx2 = idx1;
+            dist1 = dist; idx1 = idx;
+        }
+        else if (dist < dist2 || (dist == dist2 && idx < idx2))
+        {
+            dist2 = dist; idx2 = idx;
+        }
+    }
+};
+
+// Hamming distance between two rows of BinaryDescriptors, nBytes is the padded row size (stride)
+typedef uint32_t (*HammingPairKernel)(const uint8_t *a, const uint8_t *b, size_t nBytes);
+
+// the fastest implementation for the CPU we are running on, the same one the exhaustive matcher uses
+HammingPairKernel hammingPairKernel();
+
+// nearest and second nearest train descriptor for every query descriptor, found by exhaustive search with the Hamming
+// distance in one pass over the train descriptors; second[i].trainIdx is -1 if there is only one train descriptor
+void matchBinaryTop2(const cv::Mat &descQuery, const cv::Mat &descTrain, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second);
+
+// same for float descriptors and the L2 distance
+void matchFloatTop2(const cv::Mat &descQuery, const cv::Mat &descTrain, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second);
+
+#endif /* bruteForceMatcher_hpp */
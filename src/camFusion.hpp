@@ -6,16 +6,21 @@
 #include <vector>
 #include <opencv2/core.hpp>
 #include "dataStructures.h"
+#include "lidarProjection.hpp"
 
 
-void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT);
-void clusterKptMatchesWithROI(BoundingBox &boundingBox, std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches);
-void matchBoundingBoxes(std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame);
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, const PointCloud &lidarPoints, float shrinkFactor, const LidarProjector &projector);
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, const PointCloud &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT);
+void buildKeypointBoxIndex(const std::vector<cv::KeyPoint> &keypoints, const std::vector<BoundingBox> &boundingBoxes, KeypointBoxIndex &kptBoxes);
+void clusterKptMatchesWithROI(std::vector<BoundingBox> &boundingBoxes, const KeypointBoxIndex &kptBoxes, const std::vector<cv::KeyPoint> &kptsCurr, const std::vector<cv::DMatch> &kptMatches);
+void matchBoundingBoxes(const std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, const DataFrame &prevFrame, const DataFrame &currFrame, bool bOneToOne=false);
 
 void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
 
-void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr,
-                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg=nullptr);
-void computeTTCLidar(std::vector<LidarPoint> &lidarPointsPrev,
-                     std::vector<LidarPoint> &lidarPointsCurr, double frameRate, double &TTC);                  
+void computeTTCCamera(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                      const std::vector<cv::DMatch> &kptMatches, double frameRate, double &TTC, cv::Mat *visImg=nullptr, size_t maxPairs=50000);
+void computeTTCCameraExact(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                           const std::vector<cv::DMatch> &kptMatches, double frameRate, double &TTC);
+void computeTTCLidar(const PointCloud &lidarPointsPrev,
+                     const PointCloud &lidarPointsCurr, double frameRate, double &TTC, double closestPercentile=0.05);                  
 #endif /* camFusion_hpp */
@@ -2,67 +2,207 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <limits>
+#include <stdint.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "camFusion.hpp"
 #include "dataStructures.h"
+#include "timing.hpp"
 
 using namespace std;
 
 
+// Coarse raster over the union of all shrunken bounding boxes. A cell which lies completely inside exactly one box and
+// touches no other box stores the index of that box, cells touched by no box store -1; the remaining cells lie on a box
+// border or where boxes overlap (-2) and their pixels are resolved with an exact test against all boxes. Building the
+// raster costs O(box area / cellSize^2) instead of O(box area).
+struct BoxLabelMap
+{
+    enum { none = -1, border = -2 };
+    static const int cellShift = 4; // cells of 16 x 16 pixels
+
+    int x0, y0, width, height; // extent of the raster in image coordinates
+    int gridWidth, gridHeight; // extent of the raster in cells
+    std::vector<cv::Rect> boxes;
+    std::vector<int16_t> cells;
+
+    void build(const std::vector<BoundingBox> &boundingBoxes, float shrinkFactor)
+    {
+        // shrink all bounding boxes slightly to avoid having too many outlier points around the edges
+        boxes.resize(boundingBoxes.size());
+        int x1 = 0, y1 = 0;
+        x0 = y0 = 0;
+        bool bFirst = true;
+        for (size_t b = 0; b < boundingBoxes.size(); ++b)
+        {
+            const cv::Rect &roi = boundingBoxes[b].roi;
+            cv::Rect &smallerBox = boxes[b];
+            smallerBox.x = roi.x + shrinkFactor * roi.width / 2.0;
+            smallerBox.y = roi.y + shrinkFactor * roi.height / 2.0;
+            smallerBox.width = roi.width * (1 - shrinkFactor);
+            smallerBox.height = roi.height * (1 - shrinkFactor);
+            if (smallerBox.width <= 0 || smallerBox.height <= 0)
+            {
+                smallerBox = cv::Rect(); // cannot contain any point
+                continue;
+            }
+
+            x0 = bFirst ? smallerBox.x : min(x0, smallerBox.x);
+            y0 = bFirst ? smallerBox.y : min(y0, smallerBox.y);
+            x1 = bFirst ? smallerBox.x + smallerBox.width : max(x1, smallerBox.x + smallerBox.width);
+            y1 = bFirst ? smallerBox.y + smallerBox.height : max(y1, smallerBox.y + smallerBox.height);
+            bFirst = false;
+        }
+        width = x1 - x0;
+        height = y1 - y0;
+        const int cellSize = 1 << cellShift;
+        gridWidth = (width + cellSize - 1) >> cellShift;
+        gridHeight = (height + cellSize - 1) >> cellShift;
+        cells.assign((size_t)gridWidth * gridHeight, none);
+
+        // paint the cells touched by every box, only a free cell covered completely keeps the box index
+        for (size_t b = 0; b < boxes.size(); ++b)
+        {
+            const cv::Rect &box = boxes[b];
+            if (box.width <= 0)
+            {
+                continue;
+            }
+            int left = box.x - x0, top = box.y - y0, right = left + box.width, bottom = top + box.height;
+            for (int cy = top >> cellShift; cy <= (bottom - 1) >> cellShift; ++cy)
+            {
+                bool bInsideY = (cy << cellShift) >= top && ((cy + 1) << cellShift) <= bottom;
+                int16_t *row = &cells[(size_t)cy * gridWidth];
+                for (int cx = left >> cellShift; cx <= (right - 1) >> cellShift; ++cx)
+                {
+                    bool bInside = bInsideY && (cx << cellShift) >= left && ((cx + 1) << cellShift) <= right;
+                    row[cx] = (row[cx] == none && bInside) ? (int16_t)b : (int16_t)border;
+                }
+            }
+        }
+    }
+
+    // index of the single box enclosing the pixel, -1 if no box or more than one box encloses it
+    int lookup(const cv::Point &pt) const
+    {
+        if (pt.x < x0 || pt.y < y0 || pt.x >= x0 + width || pt.y >= y0 + height)
+        {
+            return none;
+        }
+        int label = cells[(size_t)((pt.y - y0) >> cellShift) * gridWidth + ((pt.x - x0) >> cellShift)];
+        if (label != border)
+        {
+            return label;
+        }
+
+        label = none;
+        for (size_t b = 0; b < boxes.size(); ++b)
+        {
+            if (boxes[b].contains(pt))
+            {
+                if (label != none)
+                {
+                    return none; // enclosed by more than one box
+                }
+                label = (int)b;
+            }
+        }
+        return label;
+    }
+};
+
 // Create groups of Lidar points whose projection into the camera falls into the same bounding box
-void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT)
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, const PointCloud &lidarPoints, float shrinkFactor, const LidarProjector &projector)
 {
-    // loop over all Lidar points and associate them to a 2D bounding box
-    cv::Mat X(4, 1, cv::DataType<double>::type);
-    cv::Mat Y(3, 1, cv::DataType<double>::type);
-
-    for (auto it1 = lidarPoints.begin(); it1 != lidarPoints.end(); ++it1)
-    {
-        // assemble vector for matrix-vector-multiplication
-        X.at<double>(0, 0) = it1->x;
-        X.at<double>(1, 0) = it1->y;
-        X.at<double>(2, 0) = it1->z;
-        X.at<double>(3, 0) = 1;
-
-        // project Lidar point into camera
-        Y = P_rect_xx * R_rect_xx * RT * X;
-        cv::Point pt;
-        pt.x = Y.at<double>(0, 0) / Y.at<double>(0, 2); // pixel coordinates
-        pt.y = Y.at<double>(1, 0) / Y.at<double>(0, 2);
-
-        vector<vector<BoundingBox>::iterator> enclosingBoxes; // pointers to all bounding boxes which enclose the current Lidar point
-        for (vector<BoundingBox>::iterator it2 = boundingBoxes.begin(); it2 != boundingBoxes.end(); ++it2)
+    TIME_SCOPE("camFusion/clusterLidarWithROI");
+
+    // per chunk of the cloud : projected pixels and, per bounding box, the indices of the points it exclusively encloses
+    struct Chunk
+    {
+        vector<cv::Point2f> pixels;
+        vector<vector<uint32_t>> buckets;
+    };
+
+    // buffers and label raster are reused from frame to frame; the worker threads must see the instances of the
+    // calling thread, hence they are accessed through references
+    static thread_local vector<Chunk> chunkBuffers;
+    static thread_local BoxLabelMap labelMapBuffer;
+    vector<Chunk> &chunks = chunkBuffers;
+    BoxLabelMap &labelMap = labelMapBuffer;
+    labelMap.build(boundingBoxes, shrinkFactor);
+
+    // the chunking only depends on the size of the cloud, hence the result does not depend on the no. of threads
+    const size_t minChunkSize = 4096, maxChunks = 64;
+    size_t nPoints = lidarPoints.size();
+    size_t nChunks = max((size_t)1, min(maxChunks, (nPoints + minChunkSize - 1) / minChunkSize));
+    size_t chunkSize = (nPoints + nChunks - 1) / nChunks;
+    chunks.resize(nChunks);
+
+    // project the points of each chunk and sort them into the buckets of the chunk
+    PointCloudView view = lidarPoints.view();
+    cv::parallel_for_(cv::Range(0, (int)nChunks), [&](const cv::Range &range) {
+        for (int c = range.start; c < range.end; ++c)
         {
-            // shrink current bounding box slightly to avoid having too many outlier points around the edges
-            cv::Rect smallerBox;
-            smallerBox.x = (*it2).roi.x + shrinkFactor * (*it2).roi.width / 2.0;
-            smallerBox.y = (*it2).roi.y + shrinkFactor * (*it2).roi.height / 2.0;
-            smallerBox.width = (*it2).roi.width * (1 - shrinkFactor);
-            smallerBox.height = (*it2).roi.height * (1 - shrinkFactor);
-
-            // check wether point is within current bounding box
-            if (smallerBox.contains(pt))
+            Chunk &chunk = chunks[c];
+            chunk.buckets.resize(boundingBoxes.size());
+            for (auto &bucket : chunk.buckets)
+            {
+                bucket.clear();
+            }
+
+            size_t begin = min(nPoints, c * chunkSize), end = min(nPoints, begin + chunkSize);
+            projector.project(view.subview(begin, end), chunk.pixels);
+            for (size_t i = begin; i < end; ++i)
             {
-                enclosingBoxes.push_back(it2);
+                const cv::Point2f &pixel = chunk.pixels[i - begin];
+                int label = labelMap.lookup(cv::Point((int)pixel.x, (int)pixel.y));
+                if (label >= 0)
+                {
+                    chunk.buckets[label].push_back((uint32_t)i);
+                }
             }
+        }
+    }, (double)nChunks);
 
-        } // eof loop over all bounding boxes
+    // merge the buckets in chunk order, which keeps the points of every box in their order within the cloud
+    cv::parallel_for_(cv::Range(0, (int)boundingBoxes.size()), [&](const cv::Range &range) {
+        for (int b = range.start; b < range.end; ++b)
+        {
+            PointCloud &boxPoints = boundingBoxes[b].lidarPoints;
+            size_t nBox = boxPoints.size();
+            for (size_t c = 0; c < nChunks; ++c)
+            {
+                nBox += chunks[c].buckets[b].size();
+            }
+            boxPoints.reserve(nBox);
 
-        // check wether point has been enclosed by one or by multiple boxes
-        if (enclosingBoxes.size() == 1)
-        { 
-            // add Lidar point to bounding box
-            enclosingBoxes[0]->lidarPoints.push_back(*it1);
+            for (size_t c = 0; c < nChunks; ++c)
+            {
+                for (uint32_t i : chunks[c].buckets[b])
+                {
+                    boxPoints.push_back(view.x[i], view.y[i], view.z[i], view.r[i]);
+                }
+            }
         }
+    });
+}
 
-    } // eof loop over all Lidar points
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, const PointCloud &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT)
+{
+    clusterLidarWithROI(boundingBoxes, lidarPoints, shrinkFactor, LidarProjector(P_rect_xx, R_rect_xx, RT));
 }
 
 
 void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize, cv::Size imageSize, bool bWait)
 {
+    TIME_SCOPE("camFusion/show3DObjects");
+
     // create topview image
     cv::Mat topviewImg(imageSize, CV_8UC3, cv::Scalar(255, 255, 255));
 
@@ -75,11 +215,11 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
         // plot Lidar points into top view image
         int top=1e8, left=1e8, bottom=0.0, right=0.0; 
         float xwmin=1e8, ywmin=1e8, ywmax=-1e8;
-        for (auto it2 = it1->lidarPoints.begin(); it2 != it1->lidarPoints.end(); ++it2)
+        for (size_t i = 0; i < it1->lidarPoints.size(); ++i)
         {
             // world coordinates
-            float xw = (*it2).x; // world position in m with x facing forward from sensor
-            float yw = (*it2).y; // world position in m with y facing left from sensor
+            float xw = it1->lidarPoints.x()[i]; // world position in m with x facing forward from sensor
+            float yw = it1->lidarPoints.y()[i]; // world position in m with y facing left from sensor
             xwmin = xwmin<xw ? xwmin : xw;
             ywmin = ywmin<yw ? ywmin : yw;
             ywmax = ywmax>yw ? ywmax : yw;
@@ -130,166 +270,497 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
 }
 
 
-// associate a given bounding box with the keypoints it contains
-void clusterKptMatchesWithROI(BoundingBox &boundingBox, std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches)
+// find the bounding boxes which enclose each keypoint, computed once per frame for all later keypoint to box lookups
+void buildKeypointBoxIndex(const std::vector<cv::KeyPoint> &keypoints, const std::vector<BoundingBox> &boundingBoxes, KeypointBoxIndex &kptBoxes)
 {
-    for (auto it1 = kptMatches.begin() + 1; it1 != kptMatches.end(); ++it1)
-    { // inner kpt.-loop
-        cv::KeyPoint kpOuterCurr = kptsCurr.at(it1->trainIdx);
-        cv::KeyPoint kpOuterPrev = kptsPrev.at(it1->queryIdx);
-
-        cv::Rect roi = boundingBox.roi;
-        if (roi.contains(kpOuterCurr.pt)){
-            //cout << " roi contins matches: x = " << kpOuterCurr.pt.x << "y = " << kpOuterCurr.pt.y << endl; 
-            boundingBox.kptMatches.push_back(*it1);
-            boundingBox.keypoints.push_back(kpOuterCurr);
+    TIME_SCOPE("camFusion/buildKeypointBoxIndex");
+
+    kptBoxes.offsets.resize(keypoints.size() + 1);
+    kptBoxes.boxIndices.clear();
+    kptBoxes.offsets[0] = 0;
+    for (size_t i = 0; i < keypoints.size(); ++i)
+    {
+        for (size_t b = 0; b < boundingBoxes.size(); ++b)
+        {
+            if (boundingBoxes[b].roi.contains(keypoints[i].pt))
+            {
+                kptBoxes.boxIndices.push_back(b);
+            }
         }
+        kptBoxes.offsets[i + 1] = kptBoxes.boxIndices.size();
+    }
+}
 
+// associate all keypoint matches with the bounding boxes which enclose their keypoint in the current frame
+void clusterKptMatchesWithROI(std::vector<BoundingBox> &boundingBoxes, const KeypointBoxIndex &kptBoxes, const std::vector<cv::KeyPoint> &kptsCurr, const std::vector<cv::DMatch> &kptMatches)
+{
+    TIME_SCOPE("camFusion/clusterKptMatchesWithROI");
 
+    for (auto it = boundingBoxes.begin(); it != boundingBoxes.end(); ++it)
+    {
+        it->keypoints.clear();
+        it->kptMatches.clear();
+    }
+
+    for (auto it = kptMatches.begin(); it != kptMatches.end(); ++it)
+    {
+        for (int k = kptBoxes.offsets[it->trainIdx]; k < kptBoxes.offsets[it->trainIdx + 1]; ++k)
+        {
+            BoundingBox &boundingBox = boundingBoxes[kptBoxes.boxIndices[k]];
+            boundingBox.kptMatches.push_back(*it);
+            boundingBox.keypoints.push_back(kptsCurr[it->trainIdx]);
+        }
     }
 }
 
 
+// median of the first n values, the values get reordered
+static double median(vector<double> &values, size_t n)
+{
+    size_t k = n / 2;
+    nth_element(values.begin(), values.begin() + k, values.begin() + n);
+    if (n % 2 == 1)
+    {
+        return values[k];
+    }
+    return (*max_element(values.begin(), values.begin() + k) + values[k]) / 2.0;
+}
+
 // Compute time-to-collision (TTC) based on keypoint correspondences in successive images
-void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, 
-                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg)
+void computeTTCCamera(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                      const std::vector<cv::DMatch> &kptMatches, double frameRate, double &TTC, cv::Mat *visImg, size_t maxPairs)
 {
+    TIME_SCOPE("camFusion/computeTTCCamera");
 
-    // compute distance ratios between all matched keypoints
-    vector<double> distRatios; // stores the distance ratios for all keypoints between curr. and prev. frame
-    for (auto it1 = kptMatches.begin(); it1 != kptMatches.end() - 1; ++it1)
-    { // outer kpt. loop
+    size_t n = kptMatches.size();
+    if (n < 2)
+    {
+        TTC = NAN;
+        return;
+    }
 
-        // get current keypoint and its matched partner in the prev. frame
-        cv::KeyPoint kpOuterCurr = kptsCurr.at(it1->trainIdx);
-        cv::KeyPoint kpOuterPrev = kptsPrev.at(it1->queryIdx);
+    // pack the matched keypoint positions, all buffers are reused from call to call
+    static thread_local vector<cv::Point2f> ptsPrev, ptsCurr;
+    static thread_local vector<uint32_t> outer, inner;
+    static thread_local vector<double> distRatios;
+    ptsPrev.resize(n);
+    ptsCurr.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        ptsPrev[i] = kptsPrev[kptMatches[i].queryIdx].pt;
+        ptsCurr[i] = kptsCurr[kptMatches[i].trainIdx].pt;
+    }
 
-        for (auto it2 = kptMatches.begin() + 1; it2 != kptMatches.end(); ++it2)
-        { // inner kpt.-loop
+    // pairs of matched keypoints : the outer keypoint runs over all but the last match and the inner one over all but the
+    // first match; if there are more of those pairs than the budget allows, a fixed-seed random sample of them is used
+    size_t nAllPairs = (n - 1) * (n - 1);
+    size_t nPairs = min(nAllPairs, max(maxPairs, (size_t)1));
+    outer.resize(nPairs);
+    inner.resize(nPairs);
+    if (nPairs == nAllPairs)
+    {
+        for (size_t i = 0, p = 0; i < n - 1; ++i)
+        {
+            for (size_t j = 1; j < n; ++j, ++p)
+            {
+                outer[p] = i;
+                inner[p] = j;
+            }
+        }
+    }
+    else
+    {
+        uint64_t state = 0x9e3779b97f4a7c15ULL; // xorshift64*, fixed seed for reproducible results
+        for (size_t p = 0; p < nPairs; ++p)
+        {
+            state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+            uint64_t rnd = state * 0x2545f4914f6cdd1dULL;
+            outer[p] = (uint32_t)((rnd >> 32) % (n - 1));
+            inner[p] = 1 + (uint32_t)((rnd & 0xffffffffULL) % (n - 1));
+        }
+    }
 
-            double minDist = 100.0; // min. required distance
+    // compute distance ratios between the paired keypoints, pairs which do not pass the distance checks are marked
+    // with a negative ratio and removed afterwards
+    const double minDist = 100.0; // min. required distance
+    distRatios.resize(nPairs);
+    for (size_t p = 0; p < nPairs; ++p)
+    {
+        cv::Point2f dCurr = ptsCurr[outer[p]] - ptsCurr[inner[p]];
+        cv::Point2f dPrev = ptsPrev[outer[p]] - ptsPrev[inner[p]];
+        double distCurr = sqrt((double)dCurr.x * dCurr.x + (double)dCurr.y * dCurr.y);
+        double distPrev = sqrt((double)dPrev.x * dPrev.x + (double)dPrev.y * dPrev.y);
 
-            // get next keypoint and its matched partner in the prev. frame
-            cv::KeyPoint kpInnerCurr = kptsCurr.at(it2->trainIdx);
-            cv::KeyPoint kpInnerPrev = kptsPrev.at(it2->queryIdx);
+        bool bValid = distPrev > std::numeric_limits<double>::epsilon() && distCurr >= minDist; // avoid division by zero
+        distRatios[p] = bValid ? distCurr / distPrev : -1.0;
+    }
+
+    size_t nRatios = 0;
+    for (size_t p = 0; p < nPairs; ++p)
+    {
+        distRatios[nRatios] = distRatios[p];
+        nRatios += distRatios[p] >= 0.0;
+    }
+
+    // only continue if list of distance ratios is not empty
+    if (nRatios == 0)
+    {
+        TTC = NAN;
+        return;
+    }
+
+    // compute camera-based TTC from the median distance ratio
+    double medianDistRatio = median(distRatios, nRatios);
+
+    double dT = 1 / frameRate;
+    TTC = -dT / (1 - medianDistRatio);
+}
 
-            // compute distances and distance ratios
-            double distCurr = cv::norm(kpOuterCurr.pt - kpInnerCurr.pt);
-            double distPrev = cv::norm(kpOuterPrev.pt - kpInnerPrev.pt);
 
-            if (distPrev > std::numeric_limits<double>::epsilon() && distCurr >= minDist)
-            { // avoid division by zero
+// Exact camera TTC over all pairs of the original double loop, evaluated on the upper triangle of the pair space :
+// the ratio of (i, j) equals the one of (j, i), so every pair i < j counts twice unless it contains the first or the
+// last match, which the original loops only visit in one order (pairs i == j never pass the min. distance check)
+struct PairRatioKernel
+{
+    const float *xPrev, *yPrev, *xCurr, *yCurr;
+    size_t n;
+
+    int weight(size_t i, size_t j) const { return (i >= 1 && j <= n - 2) ? 2 : 1; }
+
+    // appends the valid ratios of row i for the inner matches j in [i+1, n)
+    void row(size_t i, vector<double> &ratios) const;
+};
+
+static const double minPairDist = 100.0; // min. required distance
 
-                double distRatio = distCurr / distPrev;
-                distRatios.push_back(distRatio);
+static inline void appendRatio(const PairRatioKernel &k, size_t i, size_t j, double distCurr, double distPrev, vector<double> &ratios)
+{
+    if (distPrev > std::numeric_limits<double>::epsilon() && distCurr >= minPairDist)
+    {
+        double distRatio = distCurr / distPrev;
+        ratios.push_back(distRatio);
+        if (k.weight(i, j) == 2)
+        {
+            ratios.push_back(distRatio);
+        }
+    }
+}
+
+// same arithmetic as cv::norm(kp1.pt - kp2.pt) : float differences, squared and summed in double
+static void pairRatiosScalar(const PairRatioKernel &k, size_t i, size_t jBegin, vector<double> &ratios)
+{
+    for (size_t j = jBegin; j < k.n; ++j)
+    {
+        float dxc = k.xCurr[i] - k.xCurr[j], dyc = k.yCurr[i] - k.yCurr[j];
+        float dxp = k.xPrev[i] - k.xPrev[j], dyp = k.yPrev[i] - k.yPrev[j];
+        double distCurr = sqrt((double)dxc * dxc + (double)dyc * dyc);
+        double distPrev = sqrt((double)dxp * dxp + (double)dyp * dyp);
+        appendRatio(k, i, j, distCurr, distPrev, ratios);
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// 4 pairs per step; separate multiplies and adds (no FMA) keep every result bit-identical to the scalar code
+__attribute__((target("avx2"))) static void pairRatiosAvx2(const PairRatioKernel &k, size_t i, size_t jBegin, vector<double> &ratios)
+{
+    const __m128 xci = _mm_set1_ps(k.xCurr[i]), yci = _mm_set1_ps(k.yCurr[i]);
+    const __m128 xpi = _mm_set1_ps(k.xPrev[i]), ypi = _mm_set1_ps(k.yPrev[i]);
+    const __m256d eps = _mm256_set1_pd(std::numeric_limits<double>::epsilon()), minDist = _mm256_set1_pd(minPairDist);
+
+    size_t j = jBegin;
+    for (; j + 4 <= k.n; j += 4)
+    {
+        __m256d dxc = _mm256_cvtps_pd(_mm_sub_ps(xci, _mm_loadu_ps(k.xCurr + j)));
+        __m256d dyc = _mm256_cvtps_pd(_mm_sub_ps(yci, _mm_loadu_ps(k.yCurr + j)));
+        __m256d dxp = _mm256_cvtps_pd(_mm_sub_ps(xpi, _mm_loadu_ps(k.xPrev + j)));
+        __m256d dyp = _mm256_cvtps_pd(_mm_sub_ps(ypi, _mm_loadu_ps(k.yPrev + j)));
+        __m256d distCurr = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dxc, dxc), _mm256_mul_pd(dyc, dyc)));
+        __m256d distPrev = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dxp, dxp), _mm256_mul_pd(dyp, dyp)));
+
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(distPrev, eps, _CMP_GT_OQ), _mm256_cmp_pd(distCurr, minDist, _CMP_GE_OQ));
+        int mask = _mm256_movemask_pd(valid);
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        alignas(32) double distRatio[4];
+        _mm256_store_pd(distRatio, _mm256_div_pd(distCurr, distPrev));
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (mask & (1 << lane))
+            {
+                ratios.push_back(distRatio[lane]);
+                if (k.weight(i, j + lane) == 2)
+                {
+                    ratios.push_back(distRatio[lane]);
+                }
             }
-        } // eof inner loop over all matched kpts
-    }     // eof outer loop over all matched kpts
+        }
+    }
 
-    // only continue if list of distance ratios is not empty
-    if (distRatios.size() == 0)
+    pairRatiosScalar(k, i, j, ratios);
+}
+
+#endif
+
+void PairRatioKernel::row(size_t i, vector<double> &ratios) const
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool bAvx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    if (bAvx2)
+    {
+        pairRatiosAvx2(*this, i, i + 1, ratios);
+        return;
+    }
+#endif
+    pairRatiosScalar(*this, i, i + 1, ratios);
+}
+
+// k-th smallest value (0-based) of all buffers; the values must not be negative, their bit patterns then sort like
+// the values themselves, which allows a radix selection : every pass histograms the next 12 bits of the values
+// sharing the prefix found so far (in parallel over the buffers) until few enough candidates remain for nth_element
+static double selectKth(const vector<vector<double>> &buffers, size_t k)
+{
+    const int digitBits = 12;
+    const size_t nBins = 1 << digitBits, maxCandidates = 1 << 16;
+    size_t nBuffers = buffers.size();
+
+    vector<vector<uint32_t>> histograms(nBuffers, vector<uint32_t>(nBins));
+    uint64_t prefix = 0;
+    int prefixBits = 0;
+    while (prefixBits < 64)
+    {
+        int bits = min(digitBits, 64 - prefixBits), shift = 64 - prefixBits - bits;
+        cv::parallel_for_(cv::Range(0, (int)nBuffers), [&](const cv::Range &range) {
+            for (int b = range.start; b < range.end; ++b)
+            {
+                vector<uint32_t> &histogram = histograms[b];
+                fill(histogram.begin(), histogram.end(), 0);
+                for (double value : buffers[b])
+                {
+                    uint64_t u;
+                    memcpy(&u, &value, sizeof(u));
+                    if (prefixBits == 0 || (u >> (64 - prefixBits)) == prefix)
+                    {
+                        ++histogram[(u >> shift) & ((1u << bits) - 1)];
+                    }
+                }
+            }
+        }, (double)nBuffers);
+
+        // find the digit of the k-th value
+        size_t below = 0, count = 0, digit = 0;
+        for (; digit < ((size_t)1 << bits); ++digit)
+        {
+            count = 0;
+            for (size_t b = 0; b < nBuffers; ++b)
+            {
+                count += histograms[b][digit];
+            }
+            if (below + count > k)
+            {
+                break;
+            }
+            below += count;
+        }
+
+        k -= below;
+        prefix = (prefix << bits) | digit;
+        prefixBits += bits;
+        if (count <= maxCandidates)
+        {
+            break;
+        }
+    }
+
+    // all values with the final prefix, the order of the candidates does not affect the result
+    vector<double> candidates;
+    for (size_t b = 0; b < nBuffers; ++b)
+    {
+        for (double value : buffers[b])
+        {
+            uint64_t u;
+            memcpy(&u, &value, sizeof(u));
+            if (prefixBits == 64 ? u == prefix : (u >> (64 - prefixBits)) == prefix)
+            {
+                candidates.push_back(value);
+            }
+        }
+    }
+    nth_element(candidates.begin(), candidates.begin() + k, candidates.end());
+    return candidates[k];
+}
+
+void computeTTCCameraExact(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                           const std::vector<cv::DMatch> &kptMatches, double frameRate, double &TTC)
+{
+    TIME_SCOPE("camFusion/computeTTCCameraExact");
+
+    size_t n = kptMatches.size();
+    if (n < 2)
     {
         TTC = NAN;
         return;
     }
 
-    // compute camera-based TTC from distance ratios
-        // STUDENT TASK (replacement for meanDistRatio)
+    // matched keypoint positions as separate coordinate columns
+    vector<float, AlignedAllocator<float, 64>> xPrev(n), yPrev(n), xCurr(n), yCurr(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const cv::Point2f &ptPrev = kptsPrev[kptMatches[i].queryIdx].pt, &ptCurr = kptsCurr[kptMatches[i].trainIdx].pt;
+        xPrev[i] = ptPrev.x; yPrev[i] = ptPrev.y;
+        xCurr[i] = ptCurr.x; yCurr[i] = ptCurr.y;
+    }
+    PairRatioKernel kernel = {xPrev.data(), yPrev.data(), xCurr.data(), yCurr.data(), n};
+
+    // tile the triangle of pairs into blocks of consecutive rows holding about the same no. of pairs; the tiling only
+    // depends on n and every tile writes into its own buffer
+    size_t nTiles = min((size_t)32, n - 1), nPairs = n * (n - 1) / 2;
+    vector<size_t> tileRows(nTiles + 1, n - 1);
+    tileRows[0] = 0;
+    for (size_t i = 0, t = 1, pairsBefore = 0; i < n - 1 && t < nTiles; ++i)
+    {
+        pairsBefore += n - 1 - i;
+        if (pairsBefore >= t * nPairs / nTiles)
+        {
+            tileRows[t++] = i + 1;
+        }
+    }
+
+    vector<vector<double>> distRatios(nTiles);
+    cv::parallel_for_(cv::Range(0, (int)nTiles), [&](const cv::Range &range) {
+        for (int t = range.start; t < range.end; ++t)
+        {
+            for (size_t i = tileRows[t]; i < tileRows[t + 1]; ++i)
+            {
+                kernel.row(i, distRatios[t]);
+            }
+        }
+    }, (double)nTiles);
 
-	int int_median_index;
-	sort(distRatios.begin(), distRatios.end());
+    size_t nRatios = 0;
+    for (const auto &ratios : distRatios)
+    {
+        nRatios += ratios.size();
+    }
+
+    // only continue if list of distance ratios is not empty
+    if (nRatios == 0)
+    {
+        TTC = NAN;
+        return;
+    }
+
+    // median in the same way as a full sort would give it
+    double medianDistRatio = selectKth(distRatios, nRatios / 2);
+    if (nRatios % 2 == 0)
+    {
+        medianDistRatio = (selectKth(distRatios, nRatios / 2 - 1) + medianDistRatio) / 2.0;
+    }
 
-	double medianDistRatio;
-	if (distRatios.size() % 2 == 1) {
-		int_median_index = (distRatios.size() - 1) / 2;
-		medianDistRatio = distRatios[int_median_index];
-	}
-	else {
-		int_median_index = distRatios.size() / 2;
-		medianDistRatio = (distRatios[int_median_index-1] + distRatios[int_median_index])/2.0;
-	}
-  
     double dT = 1 / frameRate;
     TTC = -dT / (1 - medianDistRatio);
 }
 
 
-void computeTTCLidar(std::vector<LidarPoint> &lidarPointsPrev,
-                     std::vector<LidarPoint> &lidarPointsCurr, double frameRate, double &TTC)
+// x-distance of the point at the given percentile of the cloud sorted by x (0 = closest point), found in linear time
+static double closestDistance(const PointCloud &lidarPoints, double percentile)
 {
-    // ...
-    double Xcurrmin = 1e9;
-    std::vector<double> Distance_array;
-    std::vector<double> X_val_curr;
-    std::vector<double> X_val_prev;
-    for (auto it1 = lidarPointsCurr.begin();it1 != lidarPointsCurr.end();++it1)
-    {
-        X_val_curr.push_back(it1->x);
-        //cout << "X_val_curr"<< endl;
-        //cout << it1->x << endl;
-
-        for (auto it2 = lidarPointsPrev.begin();it2 != lidarPointsPrev.end();++it2)
-        {                //cout << "X_val_prev"<< endl;
-            //cout << it2->x << endl;
-        X_val_prev.push_back(it2->x);
-            Distance_array.push_back(it2->x-it1->x);
-        }          
-    }
-
-    sort(Distance_array.begin(),Distance_array.end());
-    sort(X_val_curr.begin(),X_val_curr.end());
-    sort(X_val_prev.begin(),X_val_prev.end());
-
-    //cout << X_val_curr[0] << X_val_curr[5] << X_val_curr[10] << X_val_curr[15] << endl;
-    //cout << X_val_prev[0] << X_val_prev[5] << X_val_prev[10] << X_val_prev[15] << endl;
-    //cout << Distance_array[0] << Distance_array[5] << Distance_array[10] << Distance_array[15] << endl;
-    //cout << Distance_array[Distance_array.size()/2-1]<< Distance_array[Distance_array.size()/2]<< endl;
-    
-
-
-    double median_velocity = (X_val_prev[5] - X_val_curr[5]);
-    TTC = X_val_curr[5] /  (median_velocity*frameRate);
-    //cout << TTC << endl;
-    //cout << median_velocity;
-    
-}
+    static thread_local vector<float> xs;
+    xs.assign(lidarPoints.x(), lidarPoints.x() + lidarPoints.size());
 
+    size_t k = (size_t)(min(max(percentile, 0.0), 1.0) * (xs.size() - 1));
+    nth_element(xs.begin(), xs.begin() + k, xs.end());
+    return xs[k];
+}
 
-void matchBoundingBoxes(std::vector<cv::DMatch> &matches, map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame)
+void computeTTCLidar(const PointCloud &lidarPointsPrev,
+                     const PointCloud &lidarPointsCurr, double frameRate, double &TTC, double closestPercentile)
 {
-	int count = 1;
-	bbBestMatches.insert({ 1, count });
-	bbBestMatches.insert({ 3, 3 });
-	bbBestMatches.insert({ 5, 3 });
+    TIME_SCOPE("camFusion/computeTTCLidar");
 
-	//first iterate through matches
-	for (int i = 0; i < matches.size(); ++i) {
+    if (lidarPointsPrev.empty() || lidarPointsCurr.empty())
+    {
+        TTC = NAN;
+        return;
+    }
 
-		//then iterate through previous frame bounding boxes
-		for (int j = 0; j < prevFrame.boundingBoxes.size(); ++j) {
+    // use a point slightly behind the closest one in both frames to be robust against single outlier points
+    double xPrev = closestDistance(lidarPointsPrev, closestPercentile);
+    double xCurr = closestDistance(lidarPointsCurr, closestPercentile);
 
-			//then iterate through previous frame bounding boxes
-			for (int k = 0; k < currFrame.boundingBoxes.size(); ++k) {
+    // constant velocity model
+    double velocity = (xPrev - xCurr) * frameRate;
+    TTC = xCurr / velocity;
+}
 
-				cv::Rect roi_prev = prevFrame.boundingBoxes[j].roi;
-				cv::Rect roi_curr = currFrame.boundingBoxes[i].roi;
 
-				int query_ind = matches[i].queryIdx;
-				int train_ind = matches[i].trainIdx;
+// associate bounding boxes between the previous and the current frame : every keypoint match votes for all pairs of
+// boxes which enclose its keypoints, then each previous box is matched with the current box it shares the most votes
+// with; with bOneToOne set, pairs are assigned greedily by descending votes so that no current box is used twice
+void matchBoundingBoxes(const std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, const DataFrame &prevFrame, const DataFrame &currFrame, bool bOneToOne)
+{
+    TIME_SCOPE("camFusion/matchBoundingBoxes");
 
-				cv::KeyPoint pt_previous_frame;
-				pt_previous_frame = prevFrame.keypoints[query_ind];
+    bbBestMatches.clear();
+    size_t nPrev = prevFrame.boundingBoxes.size(), nCurr = currFrame.boundingBoxes.size();
+    if (nPrev == 0 || nCurr == 0)
+    {
+        return;
+    }
 
-				cv::KeyPoint pt_current_frame;
-				pt_current_frame = prevFrame.keypoints[train_ind];
+    // vote matrix with one row per previous and one column per current box
+    const KeypointBoxIndex &prevIndex = prevFrame.kptBoxes, &currIndex = currFrame.kptBoxes;
+    vector<int> votes(nPrev * nCurr, 0);
+    for (auto it = matches.begin(); it != matches.end(); ++it)
+    {
+        for (int j = prevIndex.offsets[it->queryIdx]; j < prevIndex.offsets[it->queryIdx + 1]; ++j)
+        {
+            int *row = &votes[prevIndex.boxIndices[j] * nCurr];
+            for (int k = currIndex.offsets[it->trainIdx]; k < currIndex.offsets[it->trainIdx + 1]; ++k)
+            {
+                ++row[currIndex.boxIndices[k]];
+            }
+        }
+    }
+
+    if (!bOneToOne)
+    {
+        // best partner per previous box, ties go to the first current box
+        for (size_t j = 0; j < nPrev; ++j)
+        {
+            const int *row = &votes[j * nCurr];
+            size_t best = max_element(row, row + nCurr) - row;
+            if (row[best] > 0)
+            {
+                bbBestMatches[prevFrame.boundingBoxes[j].boxID] = currFrame.boundingBoxes[best].boxID;
+            }
+        }
+        return;
+    }
 
-				if (roi_prev.contains(pt_previous_frame.pt) && roi_curr.contains(pt_current_frame.pt)) {
-					int prev_box_id = prevFrame.boundingBoxes[j].boxID;
-					int curr_box_id = currFrame.boundingBoxes[k].boxID;
-					bbBestMatches.insert({ prev_box_id, curr_box_id });
-				}
-			}
+    // all supported pairs by descending votes (ties in row-major order), each box is assigned at most once
+    vector<size_t> pairs;
+    for (size_t p = 0; p < votes.size(); ++p)
+    {
+        if (votes[p] > 0)
+        {
+            pairs.push_back(p);
+        }
+    }
+    stable_sort(pairs.begin(), pairs.end(), [&](size_t a, size_t b) { return votes[a] > votes[b]; });
 
-		}
-	}
+    vector<bool> prevUsed(nPrev, false), currUsed(nCurr, false);
+    for (size_t p : pairs)
+    {
+        size_t j = p / nCurr, k = p % nCurr;
+        if (!prevUsed[j] && !currUsed[k])
+        {
+            prevUsed[j] = currUsed[k] = true;
+            bbBestMatches[prevFrame.boundingBoxes[j].boxID] = currFrame.boundingBoxes[k].boxID;
+        }
+    }
 }
+
@@ -6,9 +6,8 @@
 #include <map>
 #include <opencv2/core.hpp>
 
-struct LidarPoint { // single lidar point in space
-    double x,y,z,r; // x,y,z in [m], r is point reflectivity
-};
+#include "pointCloud.hpp"
+#include "lidarScan.hpp"
 
 struct BoundingBox { // bounding box around a classified object (contains both 2D and 3D data)
     
@@ -19,11 +18,17 @@ struct BoundingBox { // bounding box around a classified object (contains both 2
     int classID; // ID based on class file provided to YOLO framework
     double confidence; // classification trust
 
-    std::vector<LidarPoint> lidarPoints; // Lidar 3D points which project into 2D image roi
+    PointCloud lidarPoints; // Lidar 3D points which project into 2D image roi
     std::vector<cv::KeyPoint> keypoints; // keypoints enclosed by 2D roi
     std::vector<cv::DMatch> kptMatches; // keypoint matches enclosed by 2D roi
 };
 
+struct KeypointBoxIndex { // bounding boxes enclosing each keypoint of a frame, stored in compressed row form
+    
+    std::vector<int> offsets; // the boxes of keypoint i are boxIndices[offsets[i]] ... boxIndices[offsets[i+1]-1]
+    std::vector<int> boxIndices; // positions within DataFrame::boundingBoxes
+};
+
 struct DataFrame { // represents the available sensor information at the same time instance
     
     cv::Mat cameraImg; // camera image
@@ -31,10 +36,18 @@ struct DataFrame { // represents the available sensor information at the same ti
     std::vector<cv::KeyPoint> keypoints; // 2D keypoints within camera image
     cv::Mat descriptors; // keypoint descriptors
     std::vector<cv::DMatch> kptMatches; // keypoint matches between previous and current frame
-    std::vector<LidarPoint> lidarPoints;
+    LidarScan lidarScan; // memory-mapped raw scan, unmapped when the frame is dropped from the buffer
+    PointCloud lidarPoints; // Lidar 3D points of the whole scan (after cropping)
 
     std::vector<BoundingBox> boundingBoxes; // ROI around detected objects in 2D image coordinates
     std::map<int,int> bbMatches; // bounding box matches between previous and current frame
+    KeypointBoxIndex kptBoxes; // bounding boxes enclosing each keypoint
+};
+
+struct FrameJob { // data frame travelling through the processing pipeline together with its position in the sequence
+    
+    size_t imgIndex; // index of the image relative to the first image of the sequence
+    DataFrame frame;
 };
 
 #endif /* dataStructures_h */
@@ -0,0 +1,82 @@
+
+#include <sstream>
+#include <iomanip>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "framePrefetcher.hpp"
+#include "timing.hpp"
+
+using namespace std;
+
+FramePrefetcher::FramePrefetcher(std::string imgBasePath, std::string imgPrefix, std::string imgFileType,
+                                 std::string lidarPrefix, std::string lidarFileType,
+                                 int imgStartIndex, int imgEndIndex, int imgStepWidth, int imgFillWidth, size_t lookahead)
+    : imgBasePath_(imgBasePath), imgPrefix_(imgPrefix), imgFileType_(imgFileType), lidarPrefix_(lidarPrefix), lidarFileType_(lidarFileType),
+      imgStartIndex_(imgStartIndex), imgEndIndex_(imgEndIndex), imgStepWidth_(imgStepWidth), imgFillWidth_(imgFillWidth),
+      frames_(lookahead)
+{
+    loader_ = thread(&FramePrefetcher::load, this);
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    frames_.abort(); // unblocks the loader if the consumer stops early
+    loader_.join();
+}
+
+string FramePrefetcher::fileNumber(size_t imgIndex) const
+{
+    ostringstream imgNumber;
+    imgNumber << setfill('0') << setw(imgFillWidth_) << imgStartIndex_ + imgIndex;
+    return imgNumber.str();
+}
+
+bool FramePrefetcher::next(FrameJob &job)
+{
+    if (frames_.pop(job))
+    {
+        return true;
+    }
+
+    // end of sequence, report any error which stopped the loader
+    lock_guard<mutex> lock(errorMutex_);
+    if (error_)
+    {
+        rethrow_exception(error_);
+    }
+    return false;
+}
+
+// runs on the loader thread and blocks whenever 'lookahead' frames are waiting to be processed
+void FramePrefetcher::load()
+{
+    try
+    {
+        for (size_t imgIndex = 0; imgIndex <= imgEndIndex_ - imgStartIndex_; imgIndex += imgStepWidth_)
+        {
+            TIME_SCOPE("framePrefetcher/loadFrame");
+
+            FrameJob job;
+            job.imgIndex = imgIndex;
+
+            // load image from file
+            string imgFullFilename = imgBasePath_ + imgPrefix_ + fileNumber(imgIndex) + imgFileType_;
+            job.frame.cameraImg = cv::imread(imgFullFilename);
+
+            // map 3D Lidar scan, the points are read by the consumer straight from the mapping
+            string lidarFullFilename = imgBasePath_ + lidarPrefix_ + fileNumber(imgIndex) + lidarFileType_;
+            job.frame.lidarScan.open(lidarFullFilename);
+
+            if (!frames_.push(std::move(job)))
+            {
+                return; // prefetcher is being destroyed
+            }
+        }
+    }
+    catch (...)
+    {
+        lock_guard<mutex> lock(errorMutex_);
+        error_ = current_exception();
+    }
+    frames_.close();
+}
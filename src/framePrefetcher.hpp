@@ -0,0 +1,42 @@
+
+#ifndef framePrefetcher_hpp
+#define framePrefetcher_hpp
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <exception>
+
+#include "dataStructures.h"
+#include "pipeline.hpp"
+
+// loads camera images and Lidar scans of a KITTI sequence on a background thread; at most 'lookahead' decoded
+// frames are held in memory, so file access and PNG decoding overlap with the processing of earlier frames
+class FramePrefetcher
+{
+public:
+    FramePrefetcher(std::string imgBasePath, std::string imgPrefix, std::string imgFileType,
+                    std::string lidarPrefix, std::string lidarFileType,
+                    int imgStartIndex, int imgEndIndex, int imgStepWidth, int imgFillWidth, size_t lookahead);
+    ~FramePrefetcher();
+
+    // blocks until the next frame is available, returns false at the end of the sequence
+    bool next(FrameJob &job);
+
+    // assemble the file number shared by the camera image and the Lidar scan of a given index
+    std::string fileNumber(size_t imgIndex) const;
+
+private:
+    void load();
+
+    std::string imgBasePath_, imgPrefix_, imgFileType_, lidarPrefix_, lidarFileType_;
+    int imgStartIndex_, imgEndIndex_, imgStepWidth_, imgFillWidth_;
+
+    BoundedQueue<FrameJob> frames_;
+    std::thread loader_;
+    std::exception_ptr error_;
+    std::mutex errorMutex_;
+};
+
+#endif /* framePrefetcher_hpp */
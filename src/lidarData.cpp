@@ -1,68 +1,249 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "lidarData.hpp"
+#include "timing.hpp"
 
 
 using namespace std;
 
-// remove Lidar points based on min. and max distance in X, Y and Z
-void cropLidarPoints(std::vector<LidarPoint> &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR)
+// the crop kernels below compact the surviving points of the columns x, y, z, r in place and return their number;
+// a point is kept if x in [minX, maxX], z in [minZ, min(maxZ, 0)], |y| <= maxY and r >= minR
+struct CropBounds
+{
+    float minX, maxX, maxY, minZ, maxZ, minR;
+};
+
+typedef size_t (*CropKernel)(float *x, float *y, float *z, float *r, size_t begin, size_t n, const CropBounds &b);
+
+// every point is written to the next free slot and the slot is only advanced if the point lies within the
+// boundaries, which keeps the loop free of branches
+static size_t cropColumnsScalar(float *x, float *y, float *z, float *r, size_t begin, size_t n, const CropBounds &b)
 {
-    std::vector<LidarPoint> newLidarPts; 
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it) {
-        
-       if( (*it).x>=minX && (*it).x<=maxX && (*it).z>=minZ && (*it).z<=maxZ && (*it).z<=0.0 && abs((*it).y)<=maxY && (*it).r>=minR )  // Check if Lidar point is outside of boundaries
-       {
-           newLidarPts.push_back(*it);
-       }
+    size_t nKeep = begin;
+    for (size_t i = begin; i < n; ++i)
+    {
+        bool bKeep = x[i] >= b.minX && x[i] <= b.maxX && z[i] >= b.minZ && z[i] <= b.maxZ && z[i] <= 0.0f && fabs(y[i]) <= b.maxY && r[i] >= b.minR;
+        x[nKeep] = x[i]; y[nKeep] = y[i]; z[nKeep] = z[i]; r[nKeep] = r[i];
+        nKeep += bKeep;
     }
+    return nKeep;
+}
 
-    lidarPoints = newLidarPts;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// lane permutations which move the selected lanes of 8 floats to the front, indexed by the 8-bit selection mask
+static const int32_t (*compactPermutations())[8]
+{
+    static int32_t table[256][8];
+    static bool bInit = [] {
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            int n = 0;
+            for (int lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1 << lane))
+                {
+                    table[mask][n++] = lane;
+                }
+            }
+            while (n < 8)
+            {
+                table[mask][n++] = 0;
+            }
+        }
+        return true;
+    }();
+    (void)bInit;
+    return table;
 }
 
+__attribute__((target("avx2"))) static size_t cropColumnsAvx2(float *x, float *y, float *z, float *r, size_t begin, size_t n, const CropBounds &b)
+{
+    const int32_t(*perm)[8] = compactPermutations();
+    const __m256 minX = _mm256_set1_ps(b.minX), maxX = _mm256_set1_ps(b.maxX), maxY = _mm256_set1_ps(b.maxY);
+    const __m256 minZ = _mm256_set1_ps(b.minZ), maxZ = _mm256_set1_ps(std::min(b.maxZ, 0.0f)), minR = _mm256_set1_ps(b.minR);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    // all 8 lanes of a block are loaded before anything is stored, and the write position never overtakes the read
+    // position, so the full-width stores only overwrite points which have already been read
+    size_t i = begin, nKeep = begin;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i), vr = _mm256_loadu_ps(r + i);
+        __m256 keep = _mm256_and_ps(_mm256_cmp_ps(vx, minX, _CMP_GE_OQ), _mm256_cmp_ps(vx, maxX, _CMP_LE_OQ));
+        keep = _mm256_and_ps(keep, _mm256_and_ps(_mm256_cmp_ps(vz, minZ, _CMP_GE_OQ), _mm256_cmp_ps(vz, maxZ, _CMP_LE_OQ)));
+        keep = _mm256_and_ps(keep, _mm256_cmp_ps(_mm256_and_ps(vy, absMask), maxY, _CMP_LE_OQ));
+        keep = _mm256_and_ps(keep, _mm256_cmp_ps(vr, minR, _CMP_GE_OQ));
+
+        int mask = _mm256_movemask_ps(keep);
+        __m256i p = _mm256_loadu_si256((const __m256i *)perm[mask]);
+        _mm256_storeu_ps(x + nKeep, _mm256_permutevar8x32_ps(vx, p));
+        _mm256_storeu_ps(y + nKeep, _mm256_permutevar8x32_ps(vy, p));
+        _mm256_storeu_ps(z + nKeep, _mm256_permutevar8x32_ps(vz, p));
+        _mm256_storeu_ps(r + nKeep, _mm256_permutevar8x32_ps(vr, p));
+        nKeep += __builtin_popcount(mask);
+    }
 
+    // remaining points
+    size_t nTail = cropColumnsScalar(x, y, z, r, i, n, b) - i;
+    for (size_t k = 0; k < nTail; ++k)
+    {
+        x[nKeep + k] = x[i + k]; y[nKeep + k] = y[i + k]; z[nKeep + k] = z[i + k]; r[nKeep + k] = r[i + k];
+    }
+    return nKeep + nTail;
+}
 
-// Load Lidar points from a given location and store them in a vector
-void loadLidarFromFile(vector<LidarPoint> &lidarPoints, string filename)
+__attribute__((target("avx512f"))) static size_t cropColumnsAvx512(float *x, float *y, float *z, float *r, size_t begin, size_t n, const CropBounds &b)
 {
-    // allocate 4 MB buffer (only ~130*4*4 KB are needed)
-    unsigned long num = 1000000;
-    float *data = (float*)malloc(num*sizeof(float));
-    
-    // pointers
-    float *px = data+0;
-    float *py = data+1;
-    float *pz = data+2;
-    float *pr = data+3;
-    
-    // load point cloud
-    FILE *stream;
-    stream = fopen (filename.c_str(),"rb");
-    num = fread(data,sizeof(float),num,stream)/4;
- 
-    for (int32_t i=0; i<num; i++) {
-        LidarPoint lpt;
-        lpt.x = *px; lpt.y = *py; lpt.z = *pz; lpt.r = *pr;
-        lidarPoints.push_back(lpt);
-        px+=4; py+=4; pz+=4; pr+=4;
+    const __m512 minX = _mm512_set1_ps(b.minX), maxX = _mm512_set1_ps(b.maxX), maxY = _mm512_set1_ps(b.maxY);
+    const __m512 minZ = _mm512_set1_ps(b.minZ), maxZ = _mm512_set1_ps(std::min(b.maxZ, 0.0f)), minR = _mm512_set1_ps(b.minR);
+
+    size_t i = begin, nKeep = begin;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 vx = _mm512_loadu_ps(x + i), vy = _mm512_loadu_ps(y + i), vz = _mm512_loadu_ps(z + i), vr = _mm512_loadu_ps(r + i);
+        __mmask16 keep = _mm512_cmp_ps_mask(vx, minX, _CMP_GE_OQ);
+        keep = _mm512_mask_cmp_ps_mask(keep, vx, maxX, _CMP_LE_OQ);
+        keep = _mm512_mask_cmp_ps_mask(keep, vz, minZ, _CMP_GE_OQ);
+        keep = _mm512_mask_cmp_ps_mask(keep, vz, maxZ, _CMP_LE_OQ);
+        keep = _mm512_mask_cmp_ps_mask(keep, _mm512_abs_ps(vy), maxY, _CMP_LE_OQ);
+        keep = _mm512_mask_cmp_ps_mask(keep, vr, minR, _CMP_GE_OQ);
+
+        // compress stores only write the selected lanes
+        _mm512_mask_compressstoreu_ps(x + nKeep, keep, vx);
+        _mm512_mask_compressstoreu_ps(y + nKeep, keep, vy);
+        _mm512_mask_compressstoreu_ps(z + nKeep, keep, vz);
+        _mm512_mask_compressstoreu_ps(r + nKeep, keep, vr);
+        nKeep += __builtin_popcount(keep);
+    }
+
+    size_t nTail = cropColumnsScalar(x, y, z, r, i, n, b) - i;
+    for (size_t k = 0; k < nTail; ++k)
+    {
+        x[nKeep + k] = x[i + k]; y[nKeep + k] = y[i + k]; z[nKeep + k] = z[i + k]; r[nKeep + k] = r[i + k];
     }
-    fclose(stream);
+    return nKeep + nTail;
 }
 
+#endif
 
-void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait)
+// picks the widest crop kernel supported by the CPU we are running on
+static CropKernel cropKernel()
 {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const CropKernel kernel = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return (CropKernel)cropColumnsAvx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return (CropKernel)cropColumnsAvx2;
+        }
+        return (CropKernel)cropColumnsScalar;
+    }();
+    return kernel;
+#else
+    return cropColumnsScalar;
+#endif
+}
+
+// remove Lidar points based on min. and max distance in X, Y and Z
+void cropLidarPoints(PointCloud &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR)
+{
+    TIME_SCOPE("lidarData/cropLidarPoints");
+
+    CropBounds bounds = {minX, maxX, maxY, minZ, maxZ, minR};
+    size_t nKeep = cropKernel()(lidarPoints.x(), lidarPoints.y(), lidarPoints.z(), lidarPoints.r(), 0, lidarPoints.size(), bounds);
+    lidarPoints.resize(nKeep);
+}
+
+
+
+// Split a mapped Lidar scan into the coordinate columns of a point cloud
+void loadLidarFromScan(PointCloud &lidarPoints, const LidarScan &scan)
+{
+    TIME_SCOPE("lidarData/loadLidarFromScan");
+
+    size_t n = scan.size();
+    lidarPoints.resize(n);
+
+    const float *__restrict src = scan.data();
+    float *__restrict x = lidarPoints.x();
+    float *__restrict y = lidarPoints.y();
+    float *__restrict z = lidarPoints.z();
+    float *__restrict r = lidarPoints.r();
+    for (size_t i = 0; i < n; ++i, src += 4)
+    {
+        x[i] = src[0]; y[i] = src[1]; z[i] = src[2]; r[i] = src[3];
+    }
+}
+
+
+// Read a mapped Lidar scan and keep only the points within the crop boundaries, which gives the same result as
+// loadLidarFromScan followed by cropLidarPoints but never materializes the points which are removed
+void loadLidarFromScan(PointCloud &lidarPoints, const LidarScan &scan, float minX, float maxX, float maxY, float minZ, float maxZ, float minR)
+{
+    TIME_SCOPE("lidarData/loadLidarFromScanCropped");
+
+    lidarPoints.clear();
+
+    // points are split into a small staging chunk, cropped there and the survivors appended to the cloud chunk by chunk
+    const size_t chunkSize = 1024;
+    alignas(64) float x[chunkSize], y[chunkSize], z[chunkSize], r[chunkSize];
+
+    CropBounds bounds = {minX, maxX, maxY, minZ, maxZ, minR};
+    CropKernel crop = cropKernel();
+
+    const float *src = scan.data();
+    size_t n = scan.size();
+    for (size_t begin = 0; begin < n; begin += chunkSize)
+    {
+        size_t nChunk = min(n - begin, chunkSize);
+        const float *pt = src + 4 * begin;
+        for (size_t i = 0; i < nChunk; ++i, pt += 4)
+        {
+            x[i] = pt[0]; y[i] = pt[1]; z[i] = pt[2]; r[i] = pt[3];
+        }
+        size_t nKeep = crop(x, y, z, r, 0, nChunk, bounds);
+        lidarPoints.append(x, y, z, r, nKeep);
+    }
+}
+
+
+// Load Lidar points from a given location and store them in a point cloud
+void loadLidarFromFile(PointCloud &lidarPoints, string filename)
+{
+    TIME_SCOPE("lidarData/loadLidarFromFile");
+
+    lidarPoints.clear();
+
+    LidarScan scan(filename); // unmapped again when leaving this function
+    loadLidarFromScan(lidarPoints, scan);
+}
+
+
+void showLidarTopview(PointCloud &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait)
+{
+    TIME_SCOPE("lidarData/showLidarTopview");
+
     // create topview image
     cv::Mat topviewImg(imageSize, CV_8UC3, cv::Scalar(0, 0, 0));
 
     // plot Lidar points into image
-    for (auto it = lidarPoints.begin(); it != lidarPoints.end(); ++it)
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
     {
-        float xw = (*it).x; // world position in m with x facing forward from sensor
-        float yw = (*it).y; // world position in m with y facing left from sensor
+        float xw = lidarPoints.x()[i]; // world position in m with x facing forward from sensor
+        float yw = lidarPoints.y()[i]; // world position in m with y facing left from sensor
 
         int y = (-xw * imageSize.height / worldSize.height) + imageSize.height;
         int x = (-yw * imageSize.height / worldSize.height) + imageSize.width / 2;
@@ -89,8 +270,10 @@ void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize,
     }
 }
 
-void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg)
+void showLidarImgOverlay(cv::Mat &img, PointCloud &lidarPoints, const LidarProjector &projector, cv::Mat *extVisImg)
 {
+    TIME_SCOPE("lidarData/showLidarImgOverlay");
+
     // init image for visualization
     cv::Mat visImg; 
     if(extVisImg==nullptr)
@@ -105,26 +288,20 @@ void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv:
 
     // find max. x-value
     double maxVal = 0.0; 
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it)
+    for(size_t i=0; i<lidarPoints.size(); ++i)
     {
-        maxVal = maxVal<it->x ? it->x : maxVal;
+        maxVal = maxVal<lidarPoints.x()[i] ? lidarPoints.x()[i] : maxVal;
     }
 
-    cv::Mat X(4,1,cv::DataType<double>::type);
-    cv::Mat Y(3,1,cv::DataType<double>::type);
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it) {
+    // project all points into the image in one pass
+    vector<cv::Point2f> pixels;
+    projector.project(lidarPoints, pixels);
 
-            X.at<double>(0, 0) = it->x;
-            X.at<double>(1, 0) = it->y;
-            X.at<double>(2, 0) = it->z;
-            X.at<double>(3, 0) = 1;
+    for(size_t i=0; i<lidarPoints.size(); ++i) {
 
-            Y = P_rect_xx * R_rect_xx * RT * X;
-            cv::Point pt;
-            pt.x = Y.at<double>(0, 0) / Y.at<double>(0, 2);
-            pt.y = Y.at<double>(1, 0) / Y.at<double>(0, 2);
+            cv::Point pt((int)pixels[i].x, (int)pixels[i].y);
 
-            float val = it->x;
+            float val = lidarPoints.x()[i];
             int red = min(255, (int)(255 * abs((val - maxVal) / maxVal)));
             int green = min(255, (int)(255 * (1 - abs((val - maxVal) / maxVal))));
             cv::circle(overlay, pt, 5, cv::Scalar(0, green, red), -1);
@@ -145,4 +322,9 @@ void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv:
     {
         extVisImg = &visImg;
     }
+}
+
+void showLidarImgOverlay(cv::Mat &img, PointCloud &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg)
+{
+    showLidarImgOverlay(img, lidarPoints, LidarProjector(P_rect_xx, R_rect_xx, RT), extVisImg);
 }
\ No newline at end of file
@@ -7,10 +7,14 @@
 #include <string>
 
 #include "dataStructures.h"
+#include "lidarProjection.hpp"
 
-void cropLidarPoints(std::vector<LidarPoint> &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR);
-void loadLidarFromFile(std::vector<LidarPoint> &lidarPoints, std::string filename);
+void cropLidarPoints(PointCloud &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR);
+void loadLidarFromFile(PointCloud &lidarPoints, std::string filename);
+void loadLidarFromScan(PointCloud &lidarPoints, const LidarScan &scan);
+void loadLidarFromScan(PointCloud &lidarPoints, const LidarScan &scan, float minX, float maxX, float maxY, float minZ, float maxZ, float minR);
 
-void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
-void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg=nullptr);
+void showLidarTopview(PointCloud &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
+void showLidarImgOverlay(cv::Mat &img, PointCloud &lidarPoints, const LidarProjector &projector, cv::Mat *extVisImg=nullptr);
+void showLidarImgOverlay(cv::Mat &img, PointCloud &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg=nullptr);
 #endif /* lidarData_hpp */
@@ -0,0 +1,52 @@
+
+#include "lidarProjection.hpp"
+#include "timing.hpp"
+
+using namespace std;
+
+LidarProjector::LidarProjector(const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT)
+{
+    cv::Mat P = P_rect_xx * R_rect_xx * RT; // 3x4
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            P_[4 * r + c] = P.at<double>(r, c);
+        }
+    }
+}
+
+void LidarProjector::project(const PointCloudView &lidarPoints, std::vector<cv::Point2f> &pixels) const
+{
+    TIME_SCOPE("lidarProjection/project");
+
+    pixels.resize(lidarPoints.size);
+
+    // single precision is sufficient for pixel coordinates and allows twice as many points per SIMD register
+    const float p00 = (float)P_[0], p01 = (float)P_[1], p02 = (float)P_[2], p03 = (float)P_[3];
+    const float p10 = (float)P_[4], p11 = (float)P_[5], p12 = (float)P_[6], p13 = (float)P_[7];
+    const float p20 = (float)P_[8], p21 = (float)P_[9], p22 = (float)P_[10], p23 = (float)P_[11];
+
+    const float *__restrict px = lidarPoints.x;
+    const float *__restrict py = lidarPoints.y;
+    const float *__restrict pz = lidarPoints.z;
+    float *__restrict dst = (float *)pixels.data(); // interleaved u,v
+    const size_t n = lidarPoints.size;
+    for (size_t i = 0; i < n; ++i)
+    {
+        float x = px[i], y = py[i], z = pz[i];
+        float u = p00 * x + p01 * y + p02 * z + p03;
+        float v = p10 * x + p11 * y + p12 * z + p13;
+        float w = p20 * x + p21 * y + p22 * z + p23;
+        dst[2 * i] = u / w; // pixel coordinates
+        dst[2 * i + 1] = v / w;
+    }
+}
+
+cv::Point2f LidarProjector::project(const LidarPoint &lidarPoint) const
+{
+    double u = P_[0] * lidarPoint.x + P_[1] * lidarPoint.y + P_[2] * lidarPoint.z + P_[3];
+    double v = P_[4] * lidarPoint.x + P_[5] * lidarPoint.y + P_[6] * lidarPoint.z + P_[7];
+    double w = P_[8] * lidarPoint.x + P_[9] * lidarPoint.y + P_[10] * lidarPoint.z + P_[11];
+    return cv::Point2f((float)(u / w), (float)(v / w));
+}
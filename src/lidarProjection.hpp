@@ -0,0 +1,28 @@
+
+#ifndef lidarProjection_hpp
+#define lidarProjection_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+// projects Lidar points into the camera image; the calibration matrices P_rect_xx * R_rect_xx * RT are folded into
+// a single 3x4 matrix once, so projecting a point costs 9 multiply-adds and two divisions
+class LidarProjector
+{
+public:
+    LidarProjector(const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT);
+
+    // projects all points in one pass, pixels is resized to the size of the cloud (its memory can be reused across frames)
+    void project(const PointCloudView &lidarPoints, std::vector<cv::Point2f> &pixels) const;
+    void project(const PointCloud &lidarPoints, std::vector<cv::Point2f> &pixels) const { project(lidarPoints.view(), pixels); }
+
+    cv::Point2f project(const LidarPoint &lidarPoint) const;
+
+private:
+    double P_[12]; // row-major 3x4 projection matrix
+};
+
+#endif /* lidarProjection_hpp */
@@ -0,0 +1,55 @@
+
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lidarScan.hpp"
+
+using namespace std;
+
+bool LidarScan::open(const std::string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "cannot open Lidar file " << filename << endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference to the file
+    if (addr == MAP_FAILED)
+    {
+        cerr << "cannot map Lidar file " << filename << endl;
+        return false;
+    }
+
+    // the scan is read front to back exactly once, ask the kernel to start reading ahead right away
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    madvise(addr, st.st_size, MADV_WILLNEED);
+
+    data_ = (const float *)addr;
+    nBytes_ = st.st_size;
+    return true;
+}
+
+void LidarScan::close()
+{
+    if (data_ != nullptr)
+    {
+        munmap((void *)data_, nBytes_);
+        data_ = nullptr;
+        nBytes_ = 0;
+    }
+}
@@ -0,0 +1,49 @@
+
+#ifndef lidarScan_hpp
+#define lidarScan_hpp
+
+#include <stddef.h>
+#include <string>
+
+// zero-copy, read-only view of a velodyne scan file (4 floats x, y, z, r per point); the file stays memory-mapped for
+// as long as the object lives, i.e. it is unmapped on destruction or when another scan is moved into the object
+class LidarScan
+{
+public:
+    LidarScan() : data_(nullptr), nBytes_(0) {}
+    explicit LidarScan(const std::string &filename) : data_(nullptr), nBytes_(0) { open(filename); }
+    ~LidarScan() { close(); }
+
+    LidarScan(LidarScan &&other) : data_(other.data_), nBytes_(other.nBytes_)
+    {
+        other.data_ = nullptr;
+        other.nBytes_ = 0;
+    }
+    LidarScan &operator=(LidarScan &&other)
+    {
+        if (this != &other)
+        {
+            close();
+            data_ = other.data_;
+            nBytes_ = other.nBytes_;
+            other.data_ = nullptr;
+            other.nBytes_ = 0;
+        }
+        return *this;
+    }
+    LidarScan(const LidarScan &) = delete;
+    LidarScan &operator=(const LidarScan &) = delete;
+
+    bool open(const std::string &filename); // maps the file, returns false if it cannot be mapped
+    void close();                           // unmaps the file
+
+    bool isOpen() const { return data_ != nullptr; }
+    const float *data() const { return data_; }                   // interleaved x, y, z, r
+    size_t size() const { return nBytes_ / (4 * sizeof(float)); } // no. of points
+
+private:
+    const float *data_;
+    size_t nBytes_;
+};
+
+#endif /* lidarScan_hpp */
@@ -0,0 +1,166 @@
+
+#include <algorithm>
+#include <limits>
+
+#include "lshMatcher.hpp"
+#include "timing.hpp"
+
+using namespace std;
+
+BinaryLshIndex::BinaryLshIndex(int nTables, int keyBits) : nTables_(nTables), keyBits_(keyBits)
+{
+    train_.rows = 0;
+    train_.stride = 0;
+}
+
+uint32_t BinaryLshIndex::key(const uint8_t *descriptor, int table) const
+{
+    const int *bits = &bits_[table * keyBits_];
+    uint32_t k = 0;
+    for (int b = 0; b < keyBits_; ++b)
+    {
+        k |= (uint32_t)((descriptor[bits[b] >> 3] >> (bits[b] & 7)) & 1) << b;
+    }
+    return k;
+}
+
+void BinaryLshIndex::build(const cv::Mat &descriptors)
+{
+    TIME_SCOPE("lshMatcher/build");
+
+    train_.pack(descriptors);
+    if (train_.rows == 0)
+    {
+        return; // nothing to index, knn2 finds no matches
+    }
+
+    // fixed-seed random bit selection per table (xorshift64*), so results are reproducible
+    int nBits = descriptors.cols * 8;
+    bits_.resize(nTables_ * keyBits_);
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (int t = 0; t < nTables_; ++t)
+    {
+        int *bits = &bits_[t * keyBits_];
+        for (int b = 0; b < keyBits_; ++b)
+        {
+            // draw distinct bits within a table as long as the descriptor has enough of them
+            bool bUnique;
+            do
+            {
+                state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+                bits[b] = (int)((state * 0x2545f4914f6cdd1dULL >> 33) % max(nBits, 1));
+                bUnique = find(bits, bits + b, bits[b]) == bits + b;
+            } while (!bUnique && b < nBits);
+        }
+    }
+
+    // bucket the descriptors of every table with a counting sort
+    size_t nBuckets = (size_t)1 << keyBits_;
+    offsets_.assign(nTables_ * (nBuckets + 1), 0);
+    entries_.resize(nTables_ * train_.rows);
+    vector<uint32_t> keys(train_.rows);
+    for (int t = 0; t < nTables_; ++t)
+    {
+        uint32_t *offsets = &offsets_[t * (nBuckets + 1)];
+        for (size_t i = 0; i < train_.rows; ++i)
+        {
+            keys[i] = key(train_.row(i), t);
+            ++offsets[keys[i] + 1];
+        }
+        for (size_t k = 0; k < nBuckets; ++k)
+        {
+            offsets[k + 1] += offsets[k];
+        }
+
+        vector<uint32_t> fill(offsets, offsets + nBuckets);
+        uint32_t *entries = &entries_[t * train_.rows];
+        for (size_t i = 0; i < train_.rows; ++i)
+        {
+            entries[fill[keys[i]]++] = i;
+        }
+    }
+}
+
+void BinaryLshIndex::knn2(const cv::Mat &descQuery, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second) const
+{
+    TIME_SCOPE("lshMatcher/knn2");
+
+    static thread_local BinaryDescriptors queryBuffer;
+    BinaryDescriptors &query = queryBuffer;
+    query.pack(descQuery);
+
+    best.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    second.assign(query.rows, cv::DMatch(-1, -1, numeric_limits<float>::max()));
+    if (train_.rows == 0 || query.stride != train_.stride)
+    {
+        return;
+    }
+
+    HammingPairKernel distance = hammingPairKernel();
+    size_t nBuckets = (size_t)1 << keyBits_;
+    int nStripes = min((int)query.rows, 64);
+    cv::parallel_for_(cv::Range(0, (int)query.rows), [&](const cv::Range &range) {
+        // per-thread marks of the descriptors compared already for the current query
+        static thread_local vector<uint32_t> visited;
+        static thread_local uint32_t generation = 0;
+        if (visited.size() < train_.rows)
+        {
+            visited.assign(train_.rows, 0);
+            generation = 0;
+        }
+
+        for (int i = range.start; i < range.end; ++i)
+        {
+            if (++generation == 0)
+            {
+                fill(visited.begin(), visited.end(), 0);
+                generation = 1;
+            }
+
+            const uint8_t *q = query.row(i);
+            Top2<uint32_t> top2;
+            for (int t = 0; t < nTables_; ++t)
+            {
+                const uint32_t *offsets = &offsets_[t * (nBuckets + 1)];
+                const uint32_t *entries = &entries_[t * train_.rows];
+                uint32_t k = key(q, t);
+
+                // own bucket first, then all buckets whose key differs in one bit
+                for (int flip = -1; flip < keyBits_; ++flip)
+                {
+                    uint32_t bucket = flip < 0 ? k : k ^ (1u << flip);
+                    for (uint32_t e = offsets[bucket]; e < offsets[bucket + 1]; ++e)
+                    {
+                        uint32_t idx = entries[e];
+                        if (visited[idx] == generation)
+                        {
+                            continue;
+                        }
+                        visited[idx] = generation;
+                        top2.update(distance(q, train_.row(idx), train_.stride), idx);
+                    }
+                }
+            }
+
+            // without a second candidate the ratio test of the caller could not reject the match, hence a query whose
+            // buckets hold less than two descriptors is compared with all of them
+            if (top2.idx2 < 0)
+            {
+                top2 = Top2<uint32_t>();
+                for (size_t idx = 0; idx < train_.rows; ++idx)
+                {
+                    top2.update(distance(q, train_.row(idx), train_.stride), idx);
+                }
+            }
+
+            if (top2.idx1 >= 0)
+            {
+                best[i] = cv::DMatch(i, top2.idx1, (float)top2.dist1);
+            }
+            if (top2.idx2 >= 0)
+            {
+                second[i] = cv::DMatch(i, top2.idx2, (float)top2.dist2);
+            }
+        }
+    }, nStripes);
+}
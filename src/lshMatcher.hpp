@@ -0,0 +1,36 @@
+
+#ifndef lshMatcher_hpp
+#define lshMatcher_hpp
+
+#include <stdint.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "bruteForceMatcher.hpp"
+
+// locality-sensitive hashing index over binary descriptors : every hash table keys the descriptors by a fixed random
+// selection of their bits; a query probes its own bucket and all buckets one bit flip away in every table and only the
+// descriptors found there are compared with the full Hamming distance
+class BinaryLshIndex
+{
+public:
+    BinaryLshIndex(int nTables=6, int keyBits=12);
+
+    void build(const cv::Mat &descriptors); // indexes a copy, the descriptors themselves are not modified
+
+    // approximate nearest and second nearest indexed descriptor for every query descriptor; a query whose buckets hold
+    // less than two descriptors falls back to an exhaustive search, so like with matchBinaryTop2 second[i].trainIdx is
+    // -1 only if the index holds a single descriptor
+    void knn2(const cv::Mat &descQuery, std::vector<cv::DMatch> &best, std::vector<cv::DMatch> &second) const;
+
+private:
+    uint32_t key(const uint8_t *descriptor, int table) const;
+
+    int nTables_, keyBits_;
+    std::vector<int> bits_;              // selected bit positions, keyBits_ per table
+    BinaryDescriptors train_;
+    std::vector<uint32_t> offsets_;     // per table 2^keyBits_ + 1 bucket offsets into entries_
+    std::vector<uint32_t> entries_;     // descriptor indices sorted by table and bucket
+};
+
+#endif /* lshMatcher_hpp */
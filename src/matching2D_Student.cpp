@@ -1,117 +1,158 @@
 #include <numeric>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <functional>
 #include "matching2D.hpp"
+#include "bruteForceMatcher.hpp"
+#include "lshMatcher.hpp"
+#include "timing.hpp"
 
 using namespace std;
 
-// Find best matches for keypoints in two camera images based on several matching methods
-void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, cv::Mat &descSource, cv::Mat &descRef,
-                      std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, std::string selectorType)
+// Detectors, extractors and matchers are created once per configuration and then reused for the whole run. Creating
+// them is expensive (e.g. the sampling patterns of BRISK and FREAK), but an instance must not be used by several
+// threads at the same time, hence every thread keeps its own set of instances. Detectors and extractors are both
+// cv::Feature2D and share one cache, hence the keys carry the role ("det/", "desc/", "match/") besides the name.
+template <typename T>
+static cv::Ptr<T> cachedInstance(const string &key, const function<cv::Ptr<T>()> &create)
 {
-    // configure matcher
-    bool crossCheck = false;
-    cv::Ptr<cv::DescriptorMatcher> matcher;
-
-    if (matcherType.compare("MAT_BF") == 0)
+    static thread_local map<string, cv::Ptr<T>> instances;
+    auto it = instances.find(key);
+    if (it == instances.end())
     {
-        int normType = cv::NORM_HAMMING;
-        matcher = cv::BFMatcher::create(normType, crossCheck);
+        it = instances.insert(make_pair(key, create())).first;
     }
-    else if (matcherType.compare("MAT_FLANN") == 0)
-    {
-		if (descSource.type() != CV_32F)
-		{ // OpenCV bug workaround : convert binary descriptors to floating point due to a bug in current OpenCV implementation
-			descSource.convertTo(descSource, CV_32F);
-			descRef.convertTo(descRef, CV_32F);
-		}
-
-		matcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);
-		cout << "FLANN matching";
-	}
-
-
-	// perform matching task
-	if (selectorType.compare("SEL_NN") == 0)
-	{ // nearest neighbor (best match)
+    return it->second;
+}
 
-		double t = (double)cv::getTickCount();
-		matcher->match(descSource, descRef, matches); // Finds the best match for each descriptor in desc1
-		t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-		cout << " (NN) with n=" << matches.size() << " matches in " << 1000 * t / 1.0 << " ms" << endl;
-	}
+// Find best matches for keypoints in two camera images based on several matching methods
+void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, const cv::Mat &descSource, const cv::Mat &descRef,
+                      std::vector<cv::DMatch> &matches, std::string matcherType, std::string selectorType)
+{
+    TIME_SCOPE("matching2D/matchDescriptors");
+
+    // the norm follows the actual descriptor type (Hamming for binary CV_8U, L2 otherwise); all matchers deliver the
+    // two nearest neighbours of every source descriptor
+    bool bBinary = descSource.depth() == CV_8U;
+    vector<cv::DMatch> best, second;
+    if (bBinary && matcherType.compare("MAT_FLANN") == 0)
+    { // approximate search through an LSH index on the packed bits
+        BinaryLshIndex index;
+        index.build(descRef);
+        index.knn2(descSource, best, second);
+        cout << "LSH matching";
+    }
+    else if (bBinary)
+    { // exhaustive search with the native Hamming matcher
+        matchBinaryTop2(descSource, descRef, best, second);
+    }
+    else if (descSource.depth() == CV_32F && matcherType.compare("MAT_BF") == 0)
+    { // exhaustive search with the native L2 matcher
+        matchFloatTop2(descSource, descRef, best, second);
+    }
+    else
+    { // OpenCV matchers for everything else, i.e. FLANN (kd-tree) on float descriptors
+        cv::Ptr<cv::DescriptorMatcher> matcher;
+        if (matcherType.compare("MAT_FLANN") == 0)
+        {
+            matcher = cachedInstance<cv::DescriptorMatcher>("match/MAT_FLANN", [] { return cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED); });
+            cout << "FLANN matching";
+        }
+        else
+        {
+            bool crossCheck = false;
+            matcher = cachedInstance<cv::DescriptorMatcher>("match/MAT_BF_L2", [&] { return cv::BFMatcher::create(cv::NORM_L2, crossCheck); });
+        }
+
+        vector<vector<cv::DMatch>> knn_matches;
+        matcher->knnMatch(descSource, descRef, knn_matches, 2); // finds the 2 best matches
+        best.assign(knn_matches.size(), cv::DMatch(-1, -1, numeric_limits<float>::max()));
+        second.assign(knn_matches.size(), cv::DMatch(-1, -1, numeric_limits<float>::max()));
+        for (size_t i = 0; i < knn_matches.size(); ++i)
+        {
+            if (knn_matches[i].size() > 0)
+            {
+                best[i] = knn_matches[i][0];
+            }
+            if (knn_matches[i].size() > 1)
+            {
+                second[i] = knn_matches[i][1];
+            }
+        }
+    }
 
+    // perform matching task, both selectors overwrite the matches passed in
+    matches.clear();
+    if (selectorType.compare("SEL_NN") == 0)
+    { // nearest neighbor (best match)
+        copy_if(best.begin(), best.end(), back_inserter(matches), [](const cv::DMatch &m) { return m.trainIdx >= 0; });
+        cout << " (NN) with n=" << matches.size() << " matches" << endl;
+    }
     else if (selectorType.compare("SEL_KNN") == 0)
-	{ // k nearest neighbors (k=2)
-
-		vector<vector<cv::DMatch>> knn_matches;
-		double t = (double)cv::getTickCount();
-		matcher->knnMatch(descSource, descRef, knn_matches, 2); // finds the 2 best matches
-		t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-		//cout << " (KNN) with n=" << matches.size() << " matches in " << 1000 * t / 1.0 << " ms" << endl;
-
-		// STUDENT TASK
-		// filter matches using descriptor distance ratio test
-		double minDescDistRatio = 0.8;
-		for (auto it = knn_matches.begin(); it != knn_matches.end(); ++it)
-		{
-
-			if ((*it)[0].distance < minDescDistRatio * (*it)[1].distance)
-			{
-				matches.push_back((*it)[0]);
-			}
-		}
-		//cout << "# keypoints removed = " << knn_matches.size() - matches.size() << endl;
-		// EOF STUDENT TASK
-
-	}
-
-
-
+    { // k nearest neighbors (k=2)
+
+        // filter matches using descriptor distance ratio test; all matchers deliver a second neighbour whenever the
+        // reference image has more than one descriptor, a match without any competitor is kept
+        double minDescDistRatio = 0.8;
+        for (size_t i = 0; i < best.size(); ++i)
+        {
+            if (best[i].trainIdx >= 0 && (second[i].trainIdx < 0 || best[i].distance < minDescDistRatio * second[i].distance))
+            {
+                matches.push_back(best[i]);
+            }
+        }
+    }
 }
+
 // Use one of several types of state-of-art descriptors to uniquely identify keypoints
 void descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, string descriptorType)
 {
-    // select appropriate descriptor
-    cv::Ptr<cv::DescriptorExtractor> extractor;
-    if (descriptorType.compare("BRISK") == 0)
-    {
-        int threshold = 30;        // FAST/AGAST detection threshold score.
-        int octaves = 3;           // detection octaves (use 0 to do single scale)
-        float patternScale = 1.0f; // apply this scale to the pattern used for sampling the neighbourhood of a keypoint.
+    TIME_SCOPE("matching2D/descKeypoints");
 
-        extractor = cv::BRISK::create(threshold, octaves, patternScale);
-    }
-	else if (descriptorType.compare("ORB") == 0)
-	{
-		extractor = cv::ORB::create();
-	}
-	else if (descriptorType.compare("BRIEF") == 0)
-	{
-		extractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
-	}
-	else if (descriptorType.compare("FREAK") == 0)
-	{
-		extractor = cv::xfeatures2d::FREAK::create();
-	}
-	else if (descriptorType.compare("AKAZE") == 0)
-	{
-		extractor = cv::AKAZE::create();
-	}
-	else if (descriptorType.compare("SIFT") == 0)
-	{
-		extractor = cv::xfeatures2d::SIFT::create();
-	}
+    // select appropriate descriptor
+    cv::Ptr<cv::DescriptorExtractor> extractor = cachedInstance<cv::DescriptorExtractor>("desc/" + descriptorType, [&]() -> cv::Ptr<cv::DescriptorExtractor> {
+        if (descriptorType.compare("BRISK") == 0)
+        {
+            int threshold = 30;        // FAST/AGAST detection threshold score.
+            int octaves = 3;           // detection octaves (use 0 to do single scale)
+            float patternScale = 1.0f; // apply this scale to the pattern used for sampling the neighbourhood of a keypoint.
+
+            return cv::BRISK::create(threshold, octaves, patternScale);
+        }
+        else if (descriptorType.compare("ORB") == 0)
+        {
+            return cv::ORB::create();
+        }
+        else if (descriptorType.compare("BRIEF") == 0)
+        {
+            return cv::xfeatures2d::BriefDescriptorExtractor::create();
+        }
+        else if (descriptorType.compare("FREAK") == 0)
+        {
+            return cv::xfeatures2d::FREAK::create();
+        }
+        else if (descriptorType.compare("AKAZE") == 0)
+        {
+            return cv::AKAZE::create();
+        }
+        else if (descriptorType.compare("SIFT") == 0)
+        {
+            return cv::xfeatures2d::SIFT::create();
+        }
+        return cv::Ptr<cv::DescriptorExtractor>();
+    });
 	// perform feature description
-	double t = (double)cv::getTickCount();
 	extractor->compute(img, keypoints, descriptors);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	//cout << descriptorType << " descriptor extraction in " << 1000 * t / 1.0 << " ms" << endl;
-	cout << "t=" << 1000 * t / 1.0 << " ms" << endl;
+	cout << descriptorType << " descriptor extraction for n=" << keypoints.size() << " keypoints" << endl;
 
 }
 
 // Detect keypoints in image using the traditional Shi-Thomasi detector
 void detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
+    TIME_SCOPE("matching2D/detKeypointsShiTomasi");
+
     // compute detector parameters based on image size
     int blockSize = 4;       //  size of an average block for computing a derivative covariation matrix over each pixel neighborhood
     double maxOverlap = 0.0; // max. permissible overlap between two features in %
@@ -122,7 +163,6 @@ void detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool b
     double k = 0.04;
 
     // Apply corner detection
-    double t = (double)cv::getTickCount();
     vector<cv::Point2f> corners;
     cv::goodFeaturesToTrack(img, corners, maxCorners, qualityLevel, minDistance, cv::Mat(), blockSize, false, k);
 
@@ -135,9 +175,7 @@ void detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool b
         newKeyPoint.size = blockSize;
         keypoints.push_back(newKeyPoint);
     }
-    t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-    //cout << "Shi-Tomasi detection with n=" << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
-	cout << "t=" << 1000 * t / 1.0 << " ms" << endl;
+    cout << "Shi-Tomasi detection with n=" << keypoints.size() << " keypoints" << endl;
 
     // visualize results
     if (bVis)
@@ -154,66 +192,101 @@ void detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool b
 // Detect keypoints in image using the traditional Shi-Thomasi detector
 void detKeypointsHarris(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
+	TIME_SCOPE("matching2D/detKeypointsHarris");
+
 	// Detector parameters
 	int blockSize = 2; // for every pixel, a blockSize × blockSize neighborhood is considered
 	int apertureSize = 3; // aperture parameter for Sobel operator (must be odd)
 	int minResponse = 100; // minimum value for a corner in the 8bit scaled response matrix
 	double k = 0.04; // Harris parameter (see equation for details)
 
-	double t = (double)cv::getTickCount();
-
 	// Detect Harris corners and normalize output
 	cv::Mat dst, dst_norm, dst_norm_scaled;
 	dst = cv::Mat::zeros(img.size(), CV_32FC1);
 	cv::cornerHarris(img, dst, blockSize, apertureSize, k, cv::BORDER_DEFAULT);
 	cv::normalize(dst, dst_norm, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
 	cv::convertScaleAbs(dst_norm, dst_norm_scaled);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	//cout << "detKeypointsHarris with n=" << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
-	cout << "t=" << 1000 * t / 1.0 << " ms" << endl;
 
-// Look for prominent corners and instantiate keypoints
+	// Look for prominent corners in parallel row stripes, every stripe collects its candidates in row-major order
+	const int nStripes = 16;
+	vector<vector<cv::KeyPoint>> stripeCandidates(nStripes);
+	cv::parallel_for_(cv::Range(0, nStripes), [&](const cv::Range &range) {
+		for (int s = range.start; s < range.end; ++s)
+		{
+			int rowBegin = s * dst_norm.rows / nStripes, rowEnd = (s + 1) * dst_norm.rows / nStripes;
+			for (int j = rowBegin; j < rowEnd; j++)
+			{
+				const float *row = dst_norm.ptr<float>(j);
+				for (int i = 0; i < dst_norm.cols; i++)
+				{
+					int response = (int)row[i];
+					if (response > minResponse)
+					{ // only store points above a threshold
+
+						cv::KeyPoint newKeyPoint;
+						newKeyPoint.pt = cv::Point2f(i, j);
+						newKeyPoint.size = 2 * apertureSize;
+						newKeyPoint.response = response;
+						stripeCandidates[s].push_back(newKeyPoint);
+					}
+				}
+			}
+		}
+	}, nStripes);
+
+	// perform non-maximum suppression (NMS) in local neighbourhood around each candidate, in the same order and with
+	// the same decisions as comparing every candidate with every keypoint accepted so far : keypoints only overlap if
+	// they are closer than their size, so the keypoints which may overlap a candidate are found in the 3x3 cells of a
+	// grid with cells of that size; the grid stores indices into the keypoint list and is kept up to date on replacements
 	double maxOverlap = 0.0; // max. permissible overlap between two features in %, used during non-maxima suppression
-	for (size_t j = 0; j < dst_norm.rows; j++)
+	int cellSize = max(1, (int)ceil(2 * apertureSize));
+	int gridCols = dst_norm.cols / cellSize + 1, gridRows = dst_norm.rows / cellSize + 1;
+	vector<vector<int>> grid(gridCols * gridRows);
+	auto cellOf = [&](const cv::KeyPoint &kpt) { return ((int)kpt.pt.y / cellSize) * gridCols + (int)kpt.pt.x / cellSize; };
+
+	vector<int> neighbours;
+	for (auto stripe = stripeCandidates.begin(); stripe != stripeCandidates.end(); ++stripe)
 	{
-		for (size_t i = 0; i < dst_norm.cols; i++)
+		for (auto newKeyPoint = stripe->begin(); newKeyPoint != stripe->end(); ++newKeyPoint)
 		{
-
-			if ((i == 797 && j == 51) || (i == 796 && j == 56))
+			// keypoints in the neighbouring cells, in the order of the keypoint list
+			int cx = (int)newKeyPoint->pt.x / cellSize, cy = (int)newKeyPoint->pt.y / cellSize;
+			neighbours.clear();
+			for (int y = max(0, cy - 1); y <= min(gridRows - 1, cy + 1); ++y)
 			{
-				int myblah = 5;
+				for (int x = max(0, cx - 1); x <= min(gridCols - 1, cx + 1); ++x)
+				{
+					const vector<int> &cell = grid[y * gridCols + x];
+					neighbours.insert(neighbours.end(), cell.begin(), cell.end());
+				}
 			}
-			int response = (int)dst_norm.at<float>(j, i);
-			if (response > minResponse)
-			{ // only store points above a threshold
-
-				cv::KeyPoint newKeyPoint;
-				newKeyPoint.pt = cv::Point2f(i, j);
-				newKeyPoint.size = 2 * apertureSize;
-				newKeyPoint.response = response;
-
-				// perform non-maximum suppression (NMS) in local neighbourhood around new key point
-				bool bOverlap = false;
-				for (std::vector<cv::KeyPoint>::iterator it = keypoints.begin(); it != keypoints.end(); ++it)
+			sort(neighbours.begin(), neighbours.end());
+
+			bool bOverlap = false;
+			for (int idx : neighbours)
+			{
+				cv::KeyPoint &kpt = keypoints[idx];
+				double kptOverlap = cv::KeyPoint::overlap(*newKeyPoint, kpt);
+				if (kptOverlap > maxOverlap)
 				{
-					double kptOverlap = cv::KeyPoint::overlap(newKeyPoint, *it);
-					if (kptOverlap > maxOverlap)
-					{
-						bOverlap = true;
-						if (newKeyPoint.response > (*it).response)
-						{                      // if overlap is >t AND response is higher for new kpt
-							*it = newKeyPoint; // replace old key point with new one
-							break;             // quit loop over keypoints
-						}
+					bOverlap = true;
+					if (newKeyPoint->response > kpt.response)
+					{ // if overlap is >t AND response is higher for new kpt, replace old key point with new one
+						vector<int> &oldCell = grid[cellOf(kpt)];
+						oldCell.erase(find(oldCell.begin(), oldCell.end(), idx));
+						kpt = *newKeyPoint;
+						grid[cellOf(kpt)].push_back(idx);
+						break; // quit loop over keypoints
 					}
 				}
-				if (!bOverlap)
-				{                                     // only add new key point if no overlap has been found in previous NMS
-					keypoints.push_back(newKeyPoint); // store new keypoint in dynamic list
-				}
 			}
-		} // eof loop over cols
-	}     // eof loop over rows
+			if (!bOverlap)
+			{ // only add new key point if no overlap has been found in previous NMS
+				grid[cellOf(*newKeyPoint)].push_back(keypoints.size());
+				keypoints.push_back(*newKeyPoint); // store new keypoint in dynamic list
+			}
+		}
+	}
 
 	// visualize results
 	if (bVis)
@@ -231,15 +304,12 @@ void detKeypointsHarris(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis
 
 void detKeypointsBRISK(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
+	TIME_SCOPE("matching2D/detKeypointsBRISK");
 
-	double t = (double)cv::getTickCount();
-
-	cv::Ptr<cv::FeatureDetector> detector = cv::BRISK::create();
+	cv::Ptr<cv::FeatureDetector> detector = cachedInstance<cv::FeatureDetector>("det/BRISK", [] { return cv::BRISK::create(); });
 
-	t = (double)cv::getTickCount();
 	detector->detect(img, keypoints);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	cout << "Detection with n= " << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
+	cout << "BRISK detection with n=" << keypoints.size() << " keypoints" << endl;
 
 	// visualize results
 	if (bVis)
@@ -258,13 +328,12 @@ void detKeypointsBRISK(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 // Detect keypoints SIFT  detector
 void detKeypointsSIFT(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
-	double t = (double)cv::getTickCount();
+	TIME_SCOPE("matching2D/detKeypointsSIFT");
 
-	cv::Ptr<cv::FeatureDetector> detector = cv::xfeatures2d::SIFT::create();
+	cv::Ptr<cv::FeatureDetector> detector = cachedInstance<cv::FeatureDetector>("det/SIFT", [] { return cv::xfeatures2d::SIFT::create(); });
 	detector->detect(img, keypoints);
 
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	cout << "Detection with n= " << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
+	cout << "SIFT detection with n=" << keypoints.size() << " keypoints" << endl;
 
 	// visualize results
 	if (bVis)
@@ -285,12 +354,12 @@ void detKeypointsSIFT(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 
 void detKeypointsAKAZE(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
-	cv::Ptr<cv::FeatureDetector> detector = cv::AKAZE::create();
+	TIME_SCOPE("matching2D/detKeypointsAKAZE");
+
+	cv::Ptr<cv::FeatureDetector> detector = cachedInstance<cv::FeatureDetector>("det/AKAZE", [] { return cv::AKAZE::create(); });
 
-	double t = (double)cv::getTickCount();
 	detector->detect(img, keypoints);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	cout << "Detection with n= " << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
+	cout << "AKAZE detection with n=" << keypoints.size() << " keypoints" << endl;
 
 	// visualize results
 	if (bVis)
@@ -309,13 +378,12 @@ void detKeypointsAKAZE(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 
 void detKeypointsORB(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
+	TIME_SCOPE("matching2D/detKeypointsORB");
 
-	cv::Ptr<cv::FeatureDetector> detector = cv::ORB::create();
+	cv::Ptr<cv::FeatureDetector> detector = cachedInstance<cv::FeatureDetector>("det/ORB", [] { return cv::ORB::create(); });
 
-	double t = (double)cv::getTickCount();
 	detector->detect(img, keypoints);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	cout << "Detection with n= " << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
+	cout << "ORB detection with n=" << keypoints.size() << " keypoints" << endl;
 
 	// visualize results
 	if (bVis)
@@ -334,17 +402,16 @@ void detKeypointsORB(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 // Detect keypoints in image using the FAST detector
 void detKeypointsFAST(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 {
+	TIME_SCOPE("matching2D/detKeypointsFAST");
 
 	// STUDENT CODE
 	int threshold = 30;                                                              // difference between intensity of the central pixel and pixels of a circle around this pixel
 	bool bNMS = true;                                                                // perform non-maxima suppression on keypoints
 	cv::FastFeatureDetector::DetectorType type = cv::FastFeatureDetector::TYPE_9_16; // TYPE_9_16, TYPE_7_12, TYPE_5_8
-	cv::Ptr<cv::FeatureDetector> detector = cv::FastFeatureDetector::create(threshold, bNMS, type);
+	cv::Ptr<cv::FeatureDetector> detector = cachedInstance<cv::FeatureDetector>("det/FAST", [&] { return cv::FastFeatureDetector::create(threshold, bNMS, type); });
 
-	double t = (double)cv::getTickCount();
 	detector->detect(img, keypoints);
-	t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
-	cout << "Detection with n= " << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << endl;
+	cout << "FAST detection with n=" << keypoints.size() << " keypoints" << endl;
 
 	// visualize results
 	if (bVis)
@@ -362,6 +429,8 @@ void detKeypointsFAST(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
 
 void detKeypointsModern(vector<cv::KeyPoint> &keypoints, cv::Mat &img, string detectorType, bool bVis) {
 
+	TIME_SCOPE("matching2D/detKeypointsModern");
+
 	if (detectorType.compare("SHITOMASI") == 0)
 	{
 		detKeypointsShiTomasi(keypoints, img, bVis);
@@ -8,26 +8,49 @@
 #include <opencv2/highgui.hpp>
 
 #include "objectDetection2D.hpp"
+#include "timing.hpp"
 
 
 using namespace std;
 
-// detects objects in an image using the YOLO library and a set of pre-trained objects from the COCO database;
+// loads the YOLO network together with the list of class names and the names of the output layers;
 // a set of 80 classes is listed in "coco.names" and pre-trained weights are stored in "yolov3.weights"
-void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
-                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis)
+ObjectDetector::ObjectDetector(std::string classesFile, std::string modelConfiguration, std::string modelWeights,
+                               float confThreshold, float nmsThreshold)
+    : confThreshold_(confThreshold), nmsThreshold_(nmsThreshold), loadTime_(0.0), detectTime_(0.0)
 {
+    TIME_SCOPE("objectDetection2D/loadNetwork");
+
+    double t = (double)cv::getTickCount();
+
     // load class names from file
-    vector<string> classes;
     ifstream ifs(classesFile.c_str());
     string line;
-    while (getline(ifs, line)) classes.push_back(line);
+    while (getline(ifs, line)) classes_.push_back(line);
     
     // load neural network
-    cv::dnn::Net net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
-    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    net_ = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
+    net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+    // Get names of output layers
+    vector<int> outLayers = net_.getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
+    vector<cv::String> layersNames = net_.getLayerNames(); // get  names of all layers in the network
     
+    outNames_.resize(outLayers.size());
+    for (size_t i = 0; i < outLayers.size(); ++i) // Get the names of the output layers in names
+        outNames_[i] = layersNames[outLayers[i] - 1];
+
+    loadTime_ = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+}
+
+// detects objects in an image using the pre-loaded YOLO network
+void ObjectDetector::detect(cv::Mat &img, std::vector<BoundingBox> &bBoxes, bool bVis)
+{
+    TIME_SCOPE("objectDetection2D/detect");
+
+    double t = (double)cv::getTickCount();
+
     // generate 4D blob from input image
     cv::Mat blob;
     vector<cv::Mat> netOutput;
@@ -38,18 +61,9 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     bool crop = false;
     cv::dnn::blobFromImage(img, blob, scalefactor, size, mean, swapRB, crop);
     
-    // Get names of output layers
-    vector<cv::String> names;
-    vector<int> outLayers = net.getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
-    vector<cv::String> layersNames = net.getLayerNames(); // get  names of all layers in the network
-    
-    names.resize(outLayers.size());
-    for (size_t i = 0; i < outLayers.size(); ++i) // Get the names of the output layers in names
-        names[i] = layersNames[outLayers[i] - 1];
-    
     // invoke forward propagation through network
-    net.setInput(blob);
-    net.forward(netOutput, names);
+    net_.setInput(blob);
+    net_.forward(netOutput, outNames_);
     
     // Scan through all bounding boxes and keep only the ones with high confidence
     vector<int> classIds; vector<float> confidences; vector<cv::Rect> boxes;
@@ -64,7 +78,7 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
             
             // Get the value and location of the maximum score
             cv::minMaxLoc(scores, 0, &confidence, 0, &classId);
-            if (confidence > confThreshold)
+            if (confidence > confThreshold_)
             {
                 cv::Rect box; int cx, cy;
                 cx = (int)(data[0] * img.cols);
@@ -83,7 +97,7 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     
     // perform non-maxima suppression
     vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confidences, confThreshold, nmsThreshold, indices);
+    cv::dnn::NMSBoxes(boxes, confidences, confThreshold_, nmsThreshold_, indices);
     for(auto it=indices.begin(); it!=indices.end(); ++it) {
         
         BoundingBox bBox;
@@ -94,6 +108,8 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
         
         bBoxes.push_back(bBox);
     }
+
+    detectTime_ = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
     
     // show results
     if(bVis) {
@@ -110,7 +126,7 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
             cv::rectangle(visImg, cv::Point(left, top), cv::Point(left+width, top+height),cv::Scalar(0, 255, 0), 2);
             
             string label = cv::format("%.2f", (*it).confidence);
-            label = classes[((*it).classID)] + ":" + label;
+            label = classes_[((*it).classID)] + ":" + label;
         
             // Display label at the top of the bounding box
             int baseLine;
@@ -127,3 +143,14 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
         cv::waitKey(0); // wait for key to be pressed
     }
 }
+
+// detects objects in an image using the YOLO library and a set of pre-trained objects from the COCO database;
+// note that the network is reloaded on every call, use ObjectDetector when processing a sequence of images
+void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
+                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis)
+{
+    TIME_SCOPE("objectDetection2D/detectObjects");
+
+    ObjectDetector detector(classesFile, modelConfiguration, modelWeights, confThreshold, nmsThreshold);
+    detector.detect(img, bBoxes, bVis);
+}
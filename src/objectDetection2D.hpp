@@ -3,10 +3,36 @@
 #define objectDetection2D_hpp
 
 #include <stdio.h>
+#include <string>
+#include <vector>
 #include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
 
 #include "dataStructures.h"
 
+// YOLO object detector which loads the network, the class names and the output layer names only once
+// and keeps them alive across frames (a single instance must not be used by several threads at once)
+class ObjectDetector
+{
+public:
+    ObjectDetector(std::string classesFile, std::string modelConfiguration, std::string modelWeights,
+                   float confThreshold = 0.2, float nmsThreshold = 0.4);
+
+    void detect(cv::Mat &img, std::vector<BoundingBox> &bBoxes, bool bVis = false);
+
+    const std::vector<std::string> &classNames() const { return classes_; }
+    double loadTime() const { return loadTime_; }     // time in [s] spent on loading the network
+    double detectTime() const { return detectTime_; } // time in [s] spent on the last call to detect
+
+private:
+    std::vector<std::string> classes_;  // class names listed in "coco.names"
+    cv::dnn::Net net_;                  // pre-trained network
+    std::vector<cv::String> outNames_;  // names of the unconnected output layers
+    float confThreshold_, nmsThreshold_;
+
+    double loadTime_, detectTime_;
+};
+
 void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
                    std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis);
 
@@ -0,0 +1,193 @@
+
+#ifndef pipeline_hpp
+#define pipeline_hpp
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <utility>
+#include <memory>
+
+// thread-safe FIFO queue with a fixed capacity; producers block while the queue is full, consumers block while
+// it is empty, and closing the queue wakes up everybody
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+    // returns false if the queue has been closed before the item could be stored
+    bool push(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_)
+        {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // returns false once the queue has been closed and all remaining items have been consumed
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty())
+        {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    // no more items will be pushed, consumers drain what is left
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    // discard all pending items and close the queue (used when the pipeline is torn down after an error)
+    void abort()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.clear();
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+    std::mutex mutex_;
+    std::condition_variable notFull_, notEmpty_;
+};
+
+
+// linear multi-stage pipeline in which every stage runs on its own worker thread and stages are connected
+// by bounded queues; since each stage is served by exactly one worker, items leave the pipeline in the
+// order in which they were produced by the source
+template <typename T>
+class Pipeline
+{
+public:
+    explicit Pipeline(size_t queueCapacity = 2) : queueCapacity_(queueCapacity) {}
+
+    void addStage(std::string name, std::function<void(T &)> stage)
+    {
+        names_.push_back(name);
+        stages_.push_back(stage);
+    }
+
+    // the source runs on a worker thread and is called until it returns false, the sink runs on the calling
+    // thread (so that it may use the GUI); the first exception thrown by any stage is rethrown here
+    void run(std::function<bool(T &)> source, std::function<void(T &)> sink)
+    {
+        std::vector<std::unique_ptr<BoundedQueue<T>>> queues;
+        for (size_t i = 0; i <= stages_.size(); ++i)
+        {
+            queues.emplace_back(new BoundedQueue<T>(queueCapacity_));
+        }
+
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto fail = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error)
+                {
+                    error = e;
+                }
+            }
+            for (auto &q : queues)
+            {
+                q->abort();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.emplace_back([&] {
+            try
+            {
+                T item;
+                while (source(item) && queues.front()->push(std::move(item)))
+                {
+                    item = T();
+                }
+                queues.front()->close();
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        });
+
+        for (size_t i = 0; i < stages_.size(); ++i)
+        {
+            workers.emplace_back([&, i] {
+                try
+                {
+                    T item;
+                    while (queues[i]->pop(item))
+                    {
+                        stages_[i](item);
+                        if (!queues[i + 1]->push(std::move(item)))
+                        {
+                            break;
+                        }
+                    }
+                    queues[i + 1]->close();
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                }
+            });
+        }
+
+        try
+        {
+            T item;
+            while (queues.back()->pop(item))
+            {
+                sink(item);
+            }
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+
+        for (auto &w : workers)
+        {
+            w.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    const std::vector<std::string> &stageNames() const { return names_; }
+
+private:
+    size_t queueCapacity_;
+    std::vector<std::string> names_;
+    std::vector<std::function<void(T &)>> stages_;
+};
+
+#endif /* pipeline_hpp */
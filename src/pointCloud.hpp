@@ -0,0 +1,84 @@
+
+#ifndef pointCloud_hpp
+#define pointCloud_hpp
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+#include "alignedAllocator.hpp"
+
+struct LidarPoint { // single lidar point in space
+    double x,y,z,r; // x,y,z in [m], r is point reflectivity
+};
+
+// read-only, non-owning view on a range of points of a PointCloud
+struct PointCloudView
+{
+    const float *x, *y, *z, *r;
+    size_t size;
+
+    LidarPoint operator[](size_t i) const
+    {
+        LidarPoint pt;
+        pt.x = x[i]; pt.y = y[i]; pt.z = z[i]; pt.r = r[i];
+        return pt;
+    }
+
+    PointCloudView subview(size_t begin, size_t end) const
+    {
+        PointCloudView v = {x + begin, y + begin, z + begin, r + begin, end - begin};
+        return v;
+    }
+};
+
+// Lidar point cloud stored as structure of arrays, i.e. one 64-byte aligned float column per coordinate, so that
+// loops over the cloud only touch the coordinates they need and can be vectorized
+class PointCloud
+{
+public:
+    typedef std::vector<float, AlignedAllocator<float, 64>> Column;
+
+    size_t size() const { return x_.size(); }
+    bool empty() const { return x_.empty(); }
+    size_t capacity() const { return x_.capacity(); }
+
+    void reserve(size_t n) { x_.reserve(n); y_.reserve(n); z_.reserve(n); r_.reserve(n); }
+    void resize(size_t n) { x_.resize(n); y_.resize(n); z_.resize(n); r_.resize(n); }
+    void clear() { x_.clear(); y_.clear(); z_.clear(); r_.clear(); }
+
+    void push_back(float x, float y, float z, float r)
+    {
+        x_.push_back(x); y_.push_back(y); z_.push_back(z); r_.push_back(r);
+    }
+    void push_back(const LidarPoint &pt) { push_back((float)pt.x, (float)pt.y, (float)pt.z, (float)pt.r); }
+
+    // append n points given as separate coordinate columns
+    void append(const float *x, const float *y, const float *z, const float *r, size_t n)
+    {
+        x_.insert(x_.end(), x, x + n); y_.insert(y_.end(), y, y + n); z_.insert(z_.end(), z, z + n); r_.insert(r_.end(), r, r + n);
+    }
+
+    LidarPoint operator[](size_t i) const { return view()[i]; }
+
+    // direct access to the coordinate columns
+    float *x() { return x_.data(); }
+    float *y() { return y_.data(); }
+    float *z() { return z_.data(); }
+    float *r() { return r_.data(); }
+    const float *x() const { return x_.data(); }
+    const float *y() const { return y_.data(); }
+    const float *z() const { return z_.data(); }
+    const float *r() const { return r_.data(); }
+
+    PointCloudView view() const
+    {
+        PointCloudView v = {x_.data(), y_.data(), z_.data(), r_.data(), x_.size()};
+        return v;
+    }
+
+private:
+    Column x_, y_, z_, r_;
+};
+
+#endif /* pointCloud_hpp */
@@ -0,0 +1,57 @@
+
+#ifndef ringBuffer_hpp
+#define ringBuffer_hpp
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+// fixed-capacity ring buffer which holds the most recent elements of a sequence; all slots are allocated
+// once and reused, a new element is moved into the slot of the oldest one (which is thereby released)
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity) : slots_(capacity > 0 ? capacity : 1), next_(0), size_(0) {}
+
+    // move a new element into the buffer, overwriting the oldest one once the buffer is full
+    T &push(T &&elem)
+    {
+        T &slot = slots_[next_];
+        slot = std::move(elem);
+        next_ = (next_ + 1) % slots_.size();
+        size_ = size_ < slots_.size() ? size_ + 1 : size_;
+        return slot;
+    }
+
+    // access elements by age, i.e. 0 is the most recent element, 1 the one before and so on
+    T &back(size_t age = 0)
+    {
+        if (age >= size_)
+        {
+            throw std::out_of_range("RingBuffer::back : not enough elements in buffer");
+        }
+        return slots_[(next_ + slots_.size() - 1 - age) % slots_.size()];
+    }
+    const T &back(size_t age = 0) const { return const_cast<RingBuffer *>(this)->back(age); }
+
+    T &current() { return back(0); }
+    T &previous() { return back(1); }
+    const T &current() const { return back(0); }
+    const T &previous() const { return back(1); }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == slots_.size(); }
+
+    // drop all elements (the slots themselves are kept and released on their next reuse)
+    void clear() { next_ = 0; size_ = 0; }
+
+private:
+    std::vector<T> slots_;
+    size_t next_; // index of the slot which receives the next element
+    size_t size_; // no. of valid elements
+};
+
+#endif /* ringBuffer_hpp */
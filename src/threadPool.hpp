@@ -0,0 +1,128 @@
+
+#ifndef threadPool_hpp
+#define threadPool_hpp
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+
+// fixed set of worker threads which execute submitted tasks in FIFO order
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t nThreads = std::thread::hardware_concurrency()) : stop_(false)
+    {
+        nThreads = nThreads > 0 ? nThreads : 1;
+        for (size_t i = 0; i < nThreads; ++i)
+        {
+            workers_.emplace_back([this] {
+                while (true)
+                {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        wakeUp_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                        if (stop_ && tasks_.empty())
+                        {
+                            return;
+                        }
+                        task = std::move(tasks_.front());
+                        tasks_.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wakeUp_.notify_all();
+        for (auto &w : workers_)
+        {
+            w.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // queue a task for execution, its result (or exception) is delivered through the returned future
+    template <typename F>
+    auto submit(F f) -> std::future<decltype(f())>
+    {
+        typedef decltype(f()) R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+        std::future<R> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([task] { (*task)(); });
+        }
+        wakeUp_.notify_one();
+        return result;
+    }
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stop_;
+};
+
+
+// set of tasks which work on the same data (e.g. the branches of one frame); tasks are joined explicitly
+// where their results are needed, and the destructor waits for all of them so that no task outlives its data
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool) : pool_(pool) {}
+
+    ~TaskGroup()
+    {
+        for (auto &t : tasks_)
+        {
+            if (t.valid())
+            {
+                t.wait();
+            }
+        }
+    }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    // start a task on the pool, the returned id is used to join it
+    size_t run(std::function<void()> task)
+    {
+        tasks_.push_back(pool_.submit(std::move(task)));
+        return tasks_.size() - 1;
+    }
+
+    // wait until the given task has finished, rethrows any exception raised by the task
+    void join(size_t id)
+    {
+        if (tasks_[id].valid())
+        {
+            tasks_[id].get();
+        }
+    }
+
+private:
+    ThreadPool &pool_;
+    std::vector<std::future<void>> tasks_;
+};
+
+#endif /* threadPool_hpp */
@@ -0,0 +1,149 @@
+
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "timing.hpp"
+
+using namespace std;
+
+// histogram layout : bucket 0 holds everything below 1 us, bucket i covers [1.02^(i-1), 1.02^i) us
+static const double bucketGrowth = 1.02;
+static const size_t nBuckets = 1200; // the last bucket starts at 1.02^1198 us, i.e. ~5.6 h
+
+static size_t bucketIndex(double ms)
+{
+    double us = ms * 1000.0;
+    if (us < 1.0)
+    {
+        return 0;
+    }
+    size_t idx = 1 + (size_t)(log(us) / log(bucketGrowth));
+    return min(idx, nBuckets - 1);
+}
+
+static double bucketUpperBound(size_t idx)
+{
+    return pow(bucketGrowth, (double)idx) / 1000.0; // in ms
+}
+
+TimingStage::TimingStage(std::string name) : name_(name), buckets_(nBuckets, 0), count_(0), totalMs_(0.0), maxMs_(0.0)
+{
+}
+
+void TimingStage::record(double ms)
+{
+    lock_guard<mutex> lock(mutex_);
+    ++buckets_[bucketIndex(ms)];
+    ++count_;
+    totalMs_ += ms;
+    maxMs_ = max(maxMs_, ms);
+}
+
+double TimingStage::percentile(double p) const
+{
+    if (count_ == 0)
+    {
+        return 0.0;
+    }
+
+    // smallest bucket in which the cumulative count reaches the requested rank
+    uint64_t rank = (uint64_t)ceil(p * count_);
+    rank = max<uint64_t>(rank, 1);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i)
+    {
+        cumulative += buckets_[i];
+        if (cumulative >= rank)
+        {
+            return min(bucketUpperBound(i), maxMs_);
+        }
+    }
+    return maxMs_;
+}
+
+TimingStage::Summary TimingStage::summary() const
+{
+    lock_guard<mutex> lock(mutex_);
+    Summary s;
+    s.name = name_;
+    s.count = count_;
+    s.totalMs = totalMs_;
+    s.meanMs = count_ > 0 ? totalMs_ / count_ : 0.0;
+    s.p50Ms = percentile(0.50);
+    s.p95Ms = percentile(0.95);
+    s.p99Ms = percentile(0.99);
+    s.maxMs = maxMs_;
+    return s;
+}
+
+TimingRegistry &TimingRegistry::instance()
+{
+    static TimingRegistry registry;
+    return registry;
+}
+
+TimingStage &TimingRegistry::stage(const std::string &name)
+{
+    lock_guard<mutex> lock(mutex_);
+    unique_ptr<TimingStage> &stage = stages_[name];
+    if (!stage)
+    {
+        stage.reset(new TimingStage(name));
+    }
+    return *stage;
+}
+
+std::vector<TimingStage::Summary> TimingRegistry::summary() const
+{
+    lock_guard<mutex> lock(mutex_);
+    vector<TimingStage::Summary> result;
+    for (auto it = stages_.begin(); it != stages_.end(); ++it)
+    {
+        TimingStage::Summary s = it->second->summary();
+        if (s.count > 0)
+        {
+            result.push_back(s);
+        }
+    }
+    return result;
+}
+
+bool TimingRegistry::writeCsv(const std::string &filename) const
+{
+    ofstream out(filename.c_str());
+    if (!out)
+    {
+        return false;
+    }
+
+    out << "stage,count,total_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+    vector<TimingStage::Summary> stages = summary();
+    for (auto it = stages.begin(); it != stages.end(); ++it)
+    {
+        out << it->name << "," << it->count << "," << it->totalMs << "," << it->meanMs << ","
+            << it->p50Ms << "," << it->p95Ms << "," << it->p99Ms << "," << it->maxMs << "\n";
+    }
+    return (bool)out;
+}
+
+bool TimingRegistry::writeJson(const std::string &filename) const
+{
+    ofstream out(filename.c_str());
+    if (!out)
+    {
+        return false;
+    }
+
+    out << "{\n  \"stages\": [";
+    vector<TimingStage::Summary> stages = summary();
+    for (auto it = stages.begin(); it != stages.end(); ++it)
+    {
+        out << (it == stages.begin() ? "\n" : ",\n")
+            << "    {\"stage\": \"" << it->name << "\", \"count\": " << it->count << ", \"total_ms\": " << it->totalMs
+            << ", \"mean_ms\": " << it->meanMs << ", \"p50_ms\": " << it->p50Ms << ", \"p95_ms\": " << it->p95Ms
+            << ", \"p99_ms\": " << it->p99Ms << ", \"max_ms\": " << it->maxMs << "}";
+    }
+    out << "\n  ]\n}\n";
+    return (bool)out;
+}
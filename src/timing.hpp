@@ -0,0 +1,109 @@
+
+#ifndef timing_hpp
+#define timing_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+// duration statistics of a named processing stage; samples are kept in a log-scaled histogram (2% bucket width)
+// so that memory stays constant no matter how many frames are processed
+class TimingStage
+{
+public:
+    explicit TimingStage(std::string name);
+
+    void record(double ms);
+
+    struct Summary
+    {
+        std::string name;
+        uint64_t count;
+        double totalMs, meanMs, p50Ms, p95Ms, p99Ms, maxMs;
+    };
+    Summary summary() const;
+
+private:
+    double percentile(double p) const; // expects the mutex to be held
+
+    std::string name_;
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    double totalMs_, maxMs_;
+    mutable std::mutex mutex_;
+};
+
+// process-wide collection of timing stages; recording is switched off by default
+class TimingRegistry
+{
+public:
+    static TimingRegistry &instance();
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // returns the stage with the given name, creating it on first use (references stay valid)
+    TimingStage &stage(const std::string &name);
+
+    std::vector<TimingStage::Summary> summary() const;
+    bool writeCsv(const std::string &filename) const;
+    bool writeJson(const std::string &filename) const;
+
+private:
+    TimingRegistry() : enabled_(false) {}
+
+    std::atomic<bool> enabled_;
+    std::map<std::string, std::unique_ptr<TimingStage>> stages_;
+    mutable std::mutex mutex_;
+};
+
+// measures the lifetime of a scope with a monotonic clock and adds it to a stage; when timing is disabled
+// the only cost is a relaxed atomic load
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(TimingStage &stage)
+        : stage_(TimingRegistry::instance().enabled() ? &stage : nullptr)
+    {
+        if (stage_)
+        {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (stage_)
+        {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+            stage_->record(elapsed.count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    TimingStage *stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// TIME_SCOPE("module/function") times the remainder of the enclosing scope; the stage is looked up only once per
+// call site, and defining NO_TIMING removes the instrumentation altogether
+#define TIMING_CONCAT_(a, b) a##b
+#define TIMING_CONCAT(a, b) TIMING_CONCAT_(a, b)
+#ifdef NO_TIMING
+#define TIME_SCOPE(name)
+#else
+#define TIME_SCOPE(name)                                                                                    \
+    static TimingStage &TIMING_CONCAT(timingStage_, __LINE__) = TimingRegistry::instance().stage(name);   \
+    ScopedTimer TIMING_CONCAT(scopedTimer_, __LINE__)(TIMING_CONCAT(timingStage_, __LINE__))
+#endif
+
+#endif /* timing_hpp */